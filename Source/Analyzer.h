@@ -0,0 +1,435 @@
+/*
+  ==============================================================================
+
+    Analyzer.h
+
+    FFT frame and analyzer path generators, shared by the editor and the
+    offline tools.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+enum FFTOrder
+{
+    order2048 = 11,
+    order4096 = 12,
+    order8192 = 13
+};
+
+template<typename BlockType>
+struct FFTDataGenerator
+{
+    /**
+     produces the FFT data from an audio buffer, straight into the mailbox's write slot.
+     */
+    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
+    {
+        const auto fftSize = getFFTSize();
+        auto& fftData = fftDataBuffer.getWriteBuffer();
+
+        computeMagnitudes(audioData.getReadPointer(0), fftData.data());
+
+        int numBins = (int)fftSize / 2;
+
+        //normalize the fft values.
+        for (int i = 0; i < numBins; ++i)
+        {
+            auto v = fftData[i];
+            //            fftData[i] /= (float) numBins;
+            if (!std::isinf(v) && !std::isnan(v))
+            {
+                v /= float(numBins);
+            }
+            else
+            {
+                v = 0.f;
+            }
+            fftData[i] = v;
+        }
+
+        //convert them to decibels
+        for (int i = 0; i < numBins; ++i)
+        {
+            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
+        }
+
+        fftDataBuffer.finishedWrite();
+    }
+
+    /**
+     windows the first getFFTSize() samples and leaves the raw (unnormalised)
+     magnitudes of the first getFFTSize() / 2 bins at the start of output,
+     which must have room for 2 * getFFTSize() floats.
+     The FFT is this generator's own, so generators on different threads never
+     wait for each other; one generator is still only for one thread at a time.
+     */
+    void computeMagnitudes(const float* samples, float* output) const
+    {
+        const auto fftSize = getFFTSize();
+
+        std::copy(samples, samples + fftSize, output);
+        std::fill(output + fftSize, output + 2 * fftSize, 0.f);
+
+        // first apply a windowing function to our data
+        juce::FloatVectorOperations::multiply(output, window->data(), fftSize);  // [1]
+
+        // then render our FFT data..
+        forwardFFT->performFrequencyOnlyForwardTransform(output);  // [2]
+    }
+
+    void changeOrder(FFTOrder newOrder)
+    {
+        //when you change order, recreate the window, forwardFFT and the fftData slots
+        setTransformOrder(newOrder);
+        fftDataBuffer.prepare(getFFTSize() * 2);
+    }
+
+    /**
+     the window and forwardFFT only, for users of computeMagnitudes() that never
+     publish a frame: the mailbox's three 2 * getFFTSize() slots stay unallocated.
+     */
+    void setTransformOrder(FFTOrder newOrder)
+    {
+        //the window table is immutable, so it comes from the process-wide cache; the FFT is not
+        //shared, since JUCE's fallback engine locks inside perform()
+        order = newOrder;
+        auto fftSize = getFFTSize();
+
+        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
+        window = sharedResources->getBlackmanHarrisTable(fftSize);
+    }
+    //==============================================================================
+    int getFFTSize() const { return 1 << order; }
+    //==============================================================================
+    /** makes the newest FFT frame readable via getFFTData(); returns false if there was none. */
+    bool pullLatestFFTData() { return fftDataBuffer.pull(); }
+    const BlockType& getFFTData() const { return fftDataBuffer.getReadBuffer(); }
+private:
+    FFTOrder order;
+    juce::SharedResourcePointer<SharedDSPResources> sharedResources;
+    std::unique_ptr<juce::dsp::FFT> forwardFFT;
+    std::shared_ptr<const std::vector<float>> window;
+
+    TripleBuffer<BlockType> fftDataBuffer;
+};
+
+//==============================================================================
+/**
+ decimates by 2 with a linear-phase half-band FIR, in polyphase form: every
+ other tap of a half-band is zero apart from the centre one (0.5), so each
+ output costs numPairs multiply-adds on symmetric pairs plus one multiply,
+ and only the outputs that are kept get computed.
+
+ The Kaiser-windowed design is flat to within 0.001 dB up to 0.35 of the
+ output rate and rejects what would alias onto that band by more than 80 dB.
+ */
+struct HalfBandDecimator
+{
+    static constexpr int numPairs = 12;
+    static constexpr int numTaps = 4 * numPairs - 1;
+    static constexpr int centre = numTaps / 2;
+
+    /** the highest frequency, as a fraction of the output rate, that comes out unharmed. */
+    static constexpr double passbandEdge = 0.35;
+
+    HalfBandDecimator()
+    {
+        std::array<float, numTaps> window;
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t)numTaps,
+            juce::dsp::WindowingFunction<float>::kaiser, false, 7.86f);
+
+        //the odd taps of 0.5 * sinc(n / 2), scaled so they sum to 0.5 and the DC gain is exactly 1
+        double sum = 0;
+        for (int k = 0; k < numPairs; ++k)
+        {
+            const auto n = 2 * k + 1;
+            const auto x = juce::MathConstants<double>::halfPi * n;
+            coefficients[(size_t)k] = (float)(0.5 * std::sin(x) / x * window[(size_t)(centre + n)]);
+            sum += 2.0 * coefficients[(size_t)k];
+        }
+
+        for (auto& c : coefficients)
+            c = (float)(c * 0.5 / sum);
+
+        reset();
+    }
+
+    void reset()
+    {
+        line.assign((size_t)(numTaps - 1), 0.f);
+        nextOutput = 0;
+    }
+
+    /**
+     consumes any number of input samples and writes the outputs they complete
+     to output, which needs room for numSamples / 2 + 1. Returns how many.
+     */
+    int process(const float* input, int numSamples, float* output)
+    {
+        constexpr int historySize = numTaps - 1;
+        const auto total = historySize + numSamples;
+
+        //the last historySize inputs are kept at the start of line, the new ones go after them
+        line.resize((size_t)total);
+        std::copy(input, input + numSamples, line.begin() + historySize);
+
+        int numOutputs = 0;
+        int start = nextOutput;
+        for (; start + numTaps <= total; start += 2)
+        {
+            const auto* x = line.data() + start + centre;
+
+            auto y = 0.5f * x[0];
+            for (int k = 0; k < numPairs; ++k)
+                y += coefficients[(size_t)k] * (x[-(2 * k + 1)] + x[2 * k + 1]);
+
+            output[numOutputs++] = y;
+        }
+
+        std::copy(line.begin() + (total - historySize), line.begin() + total, line.begin());
+        line.resize((size_t)historySize);
+        nextOutput = start - (total - historySize);
+
+        return numOutputs;
+    }
+
+private:
+    std::array<float, numPairs> coefficients;
+    std::vector<float> line;
+    int nextOutput = 0;
+};
+
+//==============================================================================
+/**
+ one FFT at the full rate for the top of the spectrum, and one on the signal
+ decimated by 2^numStages for the bottom, where a 4096-point frame is far too
+ coarse for the 20 - 100 Hz region. Below the crossover (0.35 of the decimated
+ rate) the low band's bins are used, above it the full-rate ones; the stitched
+ frame comes with the frequency of each of its bins.
+
+ With the defaults at 48 kHz the low band runs at 6 kHz with 2.9 Hz bins, four
+ times finer than the 11.7 Hz of the full-rate frame, for the price of a
+ 2048-point FFT and three half-bands rather than a 16384-point FFT.
+
+ Levels are scaled for sinusoids, like FFTDataGenerator, so a tone reads the
+ same on either side of the crossover while broadband noise reads lower in
+ the finer band.
+ */
+template<typename BlockType>
+struct MultiResolutionFFTDataGenerator
+{
+    void prepare(double newSampleRate, FFTOrder fullOrder = order4096, FFTOrder lowOrder = order2048, int numStages = 3)
+    {
+        sampleRate = newSampleRate;
+
+        //only this generator publishes, so the inner ones skip their mailboxes
+        fullBand.setTransformOrder(fullOrder);
+        lowBand.setTransformOrder(lowOrder);
+
+        fullWindow.assign((size_t)fullBand.getFFTSize(), 0.f);
+        lowWindow.assign((size_t)lowBand.getFFTSize(), 0.f);
+        magnitudes.assign((size_t)(2 * fullBand.getFFTSize()), 0.f);
+
+        decimators.clear();
+        decimators.resize((size_t)numStages);
+
+        //lay out the stitched frame: DC and the low band up to the crossover, then the full-rate bins
+        const auto lowRate = sampleRate / (1 << numStages);
+        const auto lowBinWidth = lowRate / lowBand.getFFTSize();
+        const auto fullBinWidth = sampleRate / fullBand.getFFTSize();
+        crossover = HalfBandDecimator::passbandEdge * lowRate;
+
+        numLowBins = juce::jmin(lowBand.getFFTSize() / 2, (int)std::ceil(crossover / lowBinWidth));
+        firstFullBin = (int)std::ceil(numLowBins * lowBinWidth / fullBinWidth);
+
+        binFrequencies.clear();
+        for (int bin = 0; bin < numLowBins; ++bin)
+            binFrequencies.push_back((float)(bin * lowBinWidth));
+        for (int bin = firstFullBin; bin < fullBand.getFFTSize() / 2; ++bin)
+            binFrequencies.push_back((float)(bin * fullBinWidth));
+
+        fftDataBuffer.prepare(binFrequencies.size());
+    }
+
+    /** shifts full-rate samples into both analysis windows. */
+    void pushSamples(const float* samples, int numSamples)
+    {
+        shiftIn(fullWindow, samples, numSamples);
+
+        //each stage halves the block, so the first stage's scratch is big enough for all of them
+        stageBuffers[0].resize((size_t)(numSamples / 2 + 1));
+        stageBuffers[1].resize(stageBuffers[0].size());
+
+        const float* input = samples;
+        auto numInput = numSamples;
+        for (size_t stage = 0; stage < decimators.size(); ++stage)
+        {
+            auto& output = stageBuffers[stage % 2];
+            numInput = decimators[stage].process(input, numInput, output.data());
+            input = output.data();
+        }
+
+        shiftIn(lowWindow, input, numInput);
+    }
+
+    /** transforms both windows and publishes the stitched frame in decibels. */
+    void produceFFTDataForRendering(const float negativeInfinity)
+    {
+        auto& fftData = fftDataBuffer.getWriteBuffer();
+
+        const auto toDecibels = [negativeInfinity](float magnitude, int numBins)
+        {
+            if (std::isinf(magnitude) || std::isnan(magnitude))
+                magnitude = 0.f;
+            return juce::Decibels::gainToDecibels(magnitude / float(numBins), negativeInfinity);
+        };
+
+        lowBand.computeMagnitudes(lowWindow.data(), magnitudes.data());
+        for (int bin = 0; bin < numLowBins; ++bin)
+            fftData[(size_t)bin] = toDecibels(magnitudes[(size_t)bin], lowBand.getFFTSize() / 2);
+
+        fullBand.computeMagnitudes(fullWindow.data(), magnitudes.data());
+        for (size_t i = (size_t)numLowBins; i < fftData.size(); ++i)
+            fftData[i] = toDecibels(magnitudes[i - (size_t)numLowBins + (size_t)firstFullBin], fullBand.getFFTSize() / 2);
+
+        fftDataBuffer.finishedWrite();
+    }
+
+    //==============================================================================
+    double getSampleRate() const { return sampleRate; }
+    double getCrossoverFrequency() const { return crossover; }
+
+    /** the frequency of each value of getFFTData(), ascending. Fixed until the next prepare(). */
+    const std::vector<float>& getBinFrequencies() const { return binFrequencies; }
+    //==============================================================================
+    /** makes the newest frame readable via getFFTData(); returns false if there was none. */
+    bool pullLatestFFTData() { return fftDataBuffer.pull(); }
+    const BlockType& getFFTData() const { return fftDataBuffer.getReadBuffer(); }
+private:
+    static void shiftIn(std::vector<float>& window, const float* samples, int numSamples)
+    {
+        const auto size = (int)window.size();
+        if (numSamples >= size)
+        {
+            std::copy(samples + numSamples - size, samples + numSamples, window.begin());
+            return;
+        }
+
+        juce::FloatVectorOperations::copy(window.data(), window.data() + numSamples, size - numSamples);
+        juce::FloatVectorOperations::copy(window.data() + size - numSamples, samples, numSamples);
+    }
+
+    double sampleRate = 0, crossover = 0;
+
+    //only used for their windows and plans
+    FFTDataGenerator<BlockType> fullBand, lowBand;
+
+    std::vector<float> fullWindow, lowWindow, magnitudes;
+    std::vector<HalfBandDecimator> decimators;
+    std::array<std::vector<float>, 2> stageBuffers;
+
+    int numLowBins = 0, firstFullBin = 0;
+    std::vector<float> binFrequencies;
+
+    TripleBuffer<BlockType> fftDataBuffer;
+};
+
+//==============================================================================
+/**
+*/
+template<typename PathType>
+struct AnalyzerPathGenerator
+{
+    /*
+     converts 'renderData[]' into a juce::Path
+     */
+    void generatePath(const std::vector<float>& renderData,
+        juce::Rectangle<float> fftBounds,
+        int fftSize,
+        float binWidth,
+        float negativeInfinity)
+    {
+        generatePathFromBins(renderData, fftBounds, fftSize / 2, negativeInfinity,
+            [binWidth](int binNum) { return binNum * binWidth; });
+    }
+
+    /*
+     the same for frames whose bins are not evenly spaced, e.g. MultiResolutionFFTDataGenerator's
+     */
+    void generatePath(const std::vector<float>& renderData,
+        const std::vector<float>& binFrequencies,
+        juce::Rectangle<float> fftBounds,
+        float negativeInfinity)
+    {
+        generatePathFromBins(renderData, fftBounds, (int)binFrequencies.size(), negativeInfinity,
+            [&binFrequencies](int binNum) { return binFrequencies[(size_t)binNum]; });
+    }
+
+    /** makes the newest path readable via getPath(); returns false if there was none. */
+    bool pullLatestPath()
+    {
+        return pathBuffer.pull();
+    }
+
+    const PathType& getPath() const
+    {
+        return pathBuffer.getReadBuffer();
+    }
+private:
+    template<typename BinToFrequency>
+    void generatePathFromBins(const std::vector<float>& renderData,
+        juce::Rectangle<float> fftBounds,
+        int numBins,
+        float negativeInfinity,
+        BinToFrequency&& getBinFrequency)
+    {
+        auto top = fftBounds.getY();
+        auto bottom = fftBounds.getHeight();
+        auto width = fftBounds.getWidth();
+
+        auto& p = pathBuffer.getWriteBuffer();
+        p.clear();
+        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+
+        auto map = [bottom, top, negativeInfinity](float v)
+        {
+            return juce::jmap(v,
+                negativeInfinity, 0.f,
+                float(bottom + 10), top);
+        };
+
+        auto y = map(renderData[0]);
+
+        //        jassert( !std::isnan(y) && !std::isinf(y) );
+        if (std::isnan(y) || std::isinf(y))
+            y = bottom;
+
+        p.startNewSubPath(0, y);
+
+        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
+
+        for (int binNum = 1; binNum < numBins; binNum += pathResolution)
+        {
+            y = map(renderData[binNum]);
+
+            //            jassert( !std::isnan(y) && !std::isinf(y) );
+
+            if (!std::isnan(y) && !std::isinf(y))
+            {
+                auto binFreq = getBinFrequency(binNum);
+                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
+                int binX = std::floor(normalizedBinX * width);
+                p.lineTo(binX, y);
+            }
+        }
+
+        pathBuffer.finishedWrite();
+    }
+
+    TripleBuffer<PathType> pathBuffer;
+};
@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+    BatchEQ.cpp
+
+    Headless engine that runs many independent mono EQ instances at once.
+
+  ==============================================================================
+*/
+
+#include "BatchEQ.h"
+
+//==============================================================================
+struct BatchEQ::Job : juce::ThreadPoolJob
+{
+    Job(BatchEQ& o) : juce::ThreadPoolJob("BatchEQ"), owner(o) { }
+
+    JobStatus runJob() override
+    {
+        owner.processGroups(channels, numSamples, startGroup, endGroup, scratch.data());
+        return jobHasFinished;
+    }
+
+    BatchEQ& owner;
+    std::vector<Vec> scratch;   // one interleaved frame of lanes per sample
+
+    float* const* channels = nullptr;
+    int numSamples = 0;
+    int startGroup = 0, endGroup = 0;
+};
+
+//==============================================================================
+BatchEQ::BatchEQ()
+{
+}
+
+BatchEQ::~BatchEQ()
+{
+    if (pool != nullptr)
+        pool->removeAllJobs(false, -1);
+}
+
+void BatchEQ::prepare(int newNumInstances, double newSampleRate, int maximumBlockSize, int numThreads)
+{
+    jassert(newNumInstances >= 0 && maximumBlockSize > 0);
+
+    if (pool != nullptr)
+        pool->removeAllJobs(false, -1);
+
+    numInstances = newNumInstances;
+    numGroups = (numInstances + getNumLanes() - 1) / getNumLanes();
+    maxBlockSize = maximumBlockSize;
+    sampleRate = newSampleRate;
+
+    stages.assign((size_t)(numGroups * numStages), Stage{});
+    states.assign((size_t)(numGroups * numStages), State{});
+    activeStages.assign((size_t)numGroups, 0);
+    settings.assign((size_t)numInstances, ChainSettings{});
+    silentChannel.assign((size_t)maxBlockSize, 0.f);
+
+    numThreads = juce::jlimit(1, juce::jmax(1, numGroups), numThreads);
+
+    jobs.clear();
+    for (int i = 0; i < numThreads; ++i)
+    {
+        auto* job = jobs.add(new Job(*this));
+        job->scratch.resize((size_t)maxBlockSize);
+    }
+
+    pool.reset(numThreads > 1 ? new juce::ThreadPool(numThreads - 1) : nullptr);
+
+    for (int i = 0; i < numInstances; ++i)
+        setSettings(i, settings[(size_t)i]);
+
+    reset();
+}
+
+void BatchEQ::setSettings(int instance, const ChainSettings& chainSettings)
+{
+    jassert(juce::isPositiveAndBelow(instance, numInstances));
+
+    settings[(size_t)instance] = chainSettings;
+
+    const auto group = instance / getNumLanes();
+    const auto lane = instance % getNumLanes();
+
+    auto lowCutCoefficients = makeLowCutFilter(chainSettings, sampleRate);
+    auto highCutCoefficients = makeHighCutFilter(chainSettings, sampleRate);
+
+    //same stages as updateCutFilter(): a slope of Slope_N uses N + 1 biquads
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i <= chainSettings.lowCutSlope)
+            setStage(group, i, lane, lowCutCoefficients[i]);
+        else
+            setIdentity(group, i, lane);
+
+        if (i <= chainSettings.highCutSlope)
+            setStage(group, 5 + i, lane, highCutCoefficients[i]);
+        else
+            setIdentity(group, 5 + i, lane);
+    }
+
+    setStage(group, 4, lane, makePeakFilter(chainSettings, sampleRate));
+
+    updateActiveStages(group);
+}
+
+void BatchEQ::reset()
+{
+    for (auto& state : states)
+        state = State{};
+}
+
+void BatchEQ::setStage(int group, int stage, int lane, const Coefficients& coefficients)
+{
+    auto& s = stages[(size_t)(group * numStages + stage)];
+    const auto* c = coefficients->getRawCoefficients();
+
+    s.b0.set((size_t)lane, c[0]);
+    s.b1.set((size_t)lane, c[1]);
+    s.b2.set((size_t)lane, c[2]);
+    s.a1.set((size_t)lane, c[3]);
+    s.a2.set((size_t)lane, c[4]);
+}
+
+void BatchEQ::setIdentity(int group, int stage, int lane)
+{
+    auto& s = stages[(size_t)(group * numStages + stage)];
+
+    s.b0.set((size_t)lane, 1.f);
+    s.b1.set((size_t)lane, 0.f);
+    s.b2.set((size_t)lane, 0.f);
+    s.a1.set((size_t)lane, 0.f);
+    s.a2.set((size_t)lane, 0.f);
+}
+
+void BatchEQ::updateActiveStages(int group)
+{
+    const auto firstInstance = group * getNumLanes();
+    const auto lastInstance = juce::jmin(numInstances, firstInstance + getNumLanes());
+
+    int lowCutStages = 0, highCutStages = 0;
+    for (int i = firstInstance; i < lastInstance; ++i)
+    {
+        lowCutStages = juce::jmax(lowCutStages, settings[(size_t)i].lowCutSlope + 1);
+        highCutStages = juce::jmax(highCutStages, settings[(size_t)i].highCutSlope + 1);
+    }
+
+    int mask = 1 << 4;
+    for (int i = 0; i < lowCutStages; ++i)
+        mask |= 1 << i;
+    for (int i = 0; i < highCutStages; ++i)
+        mask |= 1 << (5 + i);
+
+    activeStages[(size_t)group] = mask;
+}
+
+//==============================================================================
+void BatchEQ::process(float* const* channels, int numSamples)
+{
+    jassert(numSamples <= maxBlockSize);
+
+    if (numGroups == 0 || numSamples <= 0)
+        return;
+
+    const auto numJobs = jobs.size();
+    const auto groupsPerJob = (numGroups + numJobs - 1) / numJobs;
+
+    for (int i = 0; i < numJobs; ++i)
+    {
+        auto* job = jobs.getUnchecked(i);
+        job->channels = channels;
+        job->numSamples = numSamples;
+        job->startGroup = juce::jmin(numGroups, i * groupsPerJob);
+        job->endGroup = juce::jmin(numGroups, job->startGroup + groupsPerJob);
+    }
+
+    //the calling thread takes the first partition itself
+    for (int i = 1; i < numJobs; ++i)
+        pool->addJob(jobs.getUnchecked(i), false);
+
+    jobs.getUnchecked(0)->runJob();
+
+    for (int i = 1; i < numJobs; ++i)
+        pool->waitForJobToFinish(jobs.getUnchecked(i), -1);
+}
+
+void BatchEQ::processGroups(float* const* channels, int numSamples, int startGroup, int endGroup, Vec* scratch)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    constexpr auto numLanes = (int)Vec::size();
+    auto* interleaved = reinterpret_cast<float*>(scratch);
+
+    for (int group = startGroup; group < endGroup; ++group)
+    {
+        const auto firstInstance = group * numLanes;
+        const auto mask = activeStages[(size_t)group];
+
+        //transpose the lanes' channels into one SIMD frame per sample
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const auto instance = firstInstance + lane;
+            const auto* src = instance < numInstances ? channels[instance] : silentChannel.data();
+
+            for (int i = 0; i < numSamples; ++i)
+                interleaved[i * numLanes + lane] = src[i];
+        }
+
+        //run the cascade stage by stage, the same order as MonoChain
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            if ((mask & (1 << stage)) == 0)
+                continue;
+
+            const auto& c = stages[(size_t)(group * numStages + stage)];
+            auto& state = states[(size_t)(group * numStages + stage)];
+
+            const auto b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+            auto s1 = state.s1, s2 = state.s2;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto input = scratch[i];
+                const auto output = (input * b0) + s1;
+                s1 = (input * b1) - (output * a1) + s2;
+                s2 = (input * b2) - (output * a2);
+                scratch[i] = output;
+            }
+
+            state.s1 = s1;
+            state.s2 = s2;
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const auto instance = firstInstance + lane;
+            if (instance >= numInstances)
+                break;
+
+            auto* dst = channels[instance];
+            for (int i = 0; i < numSamples; ++i)
+                dst[i] = interleaved[i * numLanes + lane];
+        }
+    }
+}
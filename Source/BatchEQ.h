@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    BatchEQ.h
+
+    Headless engine that runs many independent mono EQ instances at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+ Holds the coefficients and states of many mono EQ instances in
+ structure-of-arrays form, so that consecutive instances share one
+ juce::dsp::SIMDRegister and are filtered together, one lane each.
+
+ The coefficients are designed with the same makeLowCutFilter(),
+ makePeakFilter() and makeHighCutFilter() used by SimpleEQAudioProcessor,
+ and the biquads use the same transposed direct form II as
+ juce::dsp::IIR::Filter, so every lane matches a MonoChain.
+
+ Lane groups are split across a thread pool in process(). setSettings() and
+ reset() must not be called while process() is running.
+ */
+class BatchEQ
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    // 4 low cut stages, the peak and 4 high cut stages, in MonoChain order.
+    static constexpr int numStages = 9;
+
+    BatchEQ();
+    ~BatchEQ();
+
+    void prepare(int numInstances, double sampleRate, int maximumBlockSize, int numThreads);
+    void setSettings(int instance, const ChainSettings& chainSettings);
+    void reset();
+
+    /**
+     filters channels[0 .. getNumInstances()-1] in place, each holding numSamples.
+     */
+    void process(float* const* channels, int numSamples);
+
+    int getNumInstances() const { return numInstances; }
+    int getNumLaneGroups() const { return numGroups; }
+    static constexpr int getNumLanes() { return (int)Vec::size(); }
+
+private:
+    struct Stage
+    {
+        Vec b0, b1, b2, a1, a2;
+    };
+
+    struct State
+    {
+        Vec s1, s2;
+    };
+
+    struct Job;
+
+    int numInstances = 0, numGroups = 0, maxBlockSize = 0;
+    double sampleRate = 44100.0;
+
+    std::vector<Stage> stages;           // numGroups * numStages
+    std::vector<State> states;           // numGroups * numStages
+    std::vector<ChainSettings> settings; // one per instance
+    std::vector<int> activeStages;       // per group, bit i set if stage i is not bypassed in any lane
+
+    std::vector<float> silentChannel;    // feeds the unused lanes of the last group
+
+    juce::OwnedArray<Job> jobs;
+    std::unique_ptr<juce::ThreadPool> pool;
+
+    void setStage(int group, int stage, int lane, const Coefficients& coefficients);
+    void setIdentity(int group, int stage, int lane);
+    void updateActiveStages(int group);
+
+    void processGroups(float* const* channels, int numSamples, int startGroup, int endGroup, Vec* scratch);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BatchEQ)
+};
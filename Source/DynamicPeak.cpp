@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    DynamicPeak.cpp
+
+    The Peak band as a dynamic EQ: a bell whose gain follows an envelope of the
+    input or of a sidechain.
+
+  ==============================================================================
+*/
+
+#include "DynamicPeak.h"
+
+void DynamicPeakFilter::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    maxBlockSize = maximumBlockSize;
+
+    for (auto* buffer : { &levels, &gains, &k, &m1, &a1 })
+        buffer->assign((size_t)maxBlockSize, 0.f);
+
+    //keep the band where it was, only recomputed for the new rate
+    setParameters(frequency, quality, staticGainInDecibels, dynamicSettings);
+    reset();
+}
+
+void DynamicPeakFilter::reset()
+{
+    states = {};
+    detectorState = {};
+    envelope = 0.f;
+}
+
+void DynamicPeakFilter::setParameters(float newFrequency, float newQuality, float gainInDecibels, const DynamicSettings& settings)
+{
+    frequency = newFrequency;
+    quality = newQuality;
+
+    const auto clampedFrequency = juce::jlimit(1.0, 0.49 * sampleRate, (double)frequency);
+    g = (float)std::tan(juce::MathConstants<double>::pi * clampedFrequency / sampleRate);
+    kBase = 1.f / juce::jmax(0.01f, quality);
+    staticGainInDecibels = gainInDecibels;
+    dynamicSettings = settings;
+
+    auto getCoefficient = [this](float ms)
+    {
+        return (float)std::exp(-1.0 / (juce::jmax(0.01, (double)ms) * 0.001 * sampleRate));
+    };
+
+    attackCoefficient = getCoefficient(settings.attackMs);
+    releaseCoefficient = getCoefficient(settings.releaseMs);
+}
+
+void DynamicPeakFilter::process(float* const* channels, int numChannels, const float* const* detector, int numDetectorChannels, int numSamples) noexcept
+{
+    jassert(numSamples <= maxBlockSize);
+    numChannels = juce::jmin(numChannels, maxChannels);
+
+    auto* level = levels.data();
+
+    //1. detector: the mono sum, band-passed around the band (unity gain at the centre)
+    {
+        const auto da1 = 1.f / (1.f + g * (g + kBase));
+        const auto da2 = g * da1;
+        const auto scale = numDetectorChannels > 0 ? kBase / (float)numDetectorChannels : 0.f;
+
+        juce::FloatVectorOperations::clear(level, numSamples);
+        for (int ch = 0; ch < numDetectorChannels; ++ch)
+            juce::FloatVectorOperations::add(level, detector[ch], numSamples);
+
+        auto s = detectorState;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto v3 = level[i] - s.ic2eq;
+            const auto v1 = da1 * s.ic1eq + da2 * v3;
+            const auto v2 = s.ic2eq + g * v1;
+            s.ic1eq = 2.f * v1 - s.ic1eq;
+            s.ic2eq = 2.f * v2 - s.ic2eq;
+            level[i] = v1;
+        }
+        detectorState = s;
+
+        juce::FloatVectorOperations::abs(level, level, numSamples);
+        juce::FloatVectorOperations::multiply(level, scale, numSamples);
+    }
+
+    //2. envelope follower, the only other recursion in the control path
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto coefficient = level[i] > envelope ? attackCoefficient : releaseCoefficient;
+        envelope = level[i] + coefficient * (envelope - level[i]);
+        level[i] = envelope;
+    }
+
+    //3. gain and SVF terms for the whole block, sample-independent and vectorisable
+    auto* gain = gains.data();
+    for (int i = 0; i < numSamples; ++i)
+        gain[i] = 20.f * std::log10(juce::jmax(level[i], 1.0e-6f));
+
+    const auto range = dynamicSettings.mode == Peak_Dynamic ? dynamicSettings.rangeInDecibels : 0.f;
+    juce::FloatVectorOperations::add(gain, -dynamicSettings.thresholdInDecibels, numSamples);
+    juce::FloatVectorOperations::multiply(gain, 1.f / rampInDecibels, numSamples);
+    juce::FloatVectorOperations::clip(gain, gain, 0.f, 1.f, numSamples);
+    juce::FloatVectorOperations::multiply(gain, range, numSamples);
+    juce::FloatVectorOperations::add(gain, staticGainInDecibels, numSamples);
+
+    //A = 10^(dB / 40)
+    const auto toExponent = std::log(10.f) / 40.f;
+    for (int i = 0; i < numSamples; ++i)
+        gain[i] = std::exp(gain[i] * toExponent);
+
+    auto* kk = k.data();
+    auto* mm = m1.data();
+    auto* aa = a1.data();
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto A = gain[i];
+        kk[i] = kBase / A;
+        mm[i] = kk[i] * (A * A - 1.f);
+        aa[i] = 1.f / (1.f + g * (g + kk[i]));
+    }
+
+    //4. the bell itself, per sample with that sample's terms
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* x = channels[ch];
+        auto s = states[(size_t)ch];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto v0 = x[i];
+            const auto v3 = v0 - s.ic2eq;
+            const auto v1 = aa[i] * (s.ic1eq + g * v3);
+            const auto v2 = s.ic2eq + g * v1;
+            s.ic1eq = 2.f * v1 - s.ic1eq;
+            s.ic2eq = 2.f * v2 - s.ic2eq;
+            x[i] = v0 + mm[i] * v1;
+        }
+
+        //keep the integrators out of the denormal range after silence
+        if (std::abs(s.ic1eq) < 1.0e-15f) s.ic1eq = 0.f;
+        if (std::abs(s.ic2eq) < 1.0e-15f) s.ic2eq = 0.f;
+        states[(size_t)ch] = s;
+    }
+}
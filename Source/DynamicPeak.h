@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    DynamicPeak.h
+
+    The Peak band as a dynamic EQ: a bell whose gain follows an envelope of the
+    input or of a sidechain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum PeakMode
+{
+    Peak_Static,
+    Peak_Dynamic
+};
+
+enum DynamicSource
+{
+    Source_Input,
+    Source_Sidechain
+};
+
+struct DynamicSettings
+{
+    PeakMode mode{ Peak_Static };
+    DynamicSource source{ Source_Input };
+    float thresholdInDecibels{ -24.f }, rangeInDecibels{ -6.f };
+    float attackMs{ 5.f }, releaseMs{ 100.f };
+
+    bool operator==(const DynamicSettings& other) const
+    {
+        return mode == other.mode
+            && source == other.source
+            && thresholdInDecibels == other.thresholdInDecibels
+            && rangeInDecibels == other.rangeInDecibels
+            && attackMs == other.attackMs
+            && releaseMs == other.releaseMs;
+    }
+
+    bool operator!=(const DynamicSettings& other) const { return !(*this == other); }
+};
+
+//==============================================================================
+/**
+ A bell built on the topology-preserving (trapezoidal) state-variable filter
+ from A. Simper, "Linear Trapezoidal Integrated SVF" (2013):
+
+     k = 1 / (Q * A),  m1 = k * (A^2 - 1),  y = x + m1 * bandpass
+
+ with A = 10^(gain / 40), which matches the shape of makePeakFilter()'s RBJ
+ bell. The integrator states keep their meaning whatever the coefficients are,
+ so A may change on every sample without the clicks a biquad would make.
+
+ Each block runs in stages: the detector band-passes the input or sidechain
+ around the band's frequency, the envelope follower rectifies and smooths it,
+ and then the gain, k, m1 and the SVF's a1 are computed for the whole block
+ with FloatVectorOperations and loops that have no dependencies between
+ samples. Only the filter itself then runs sample by sample. The gain moves
+ from Peak Gain at the threshold to Peak Gain + range 12 dB above it.
+ */
+class DynamicPeakFilter
+{
+public:
+    static constexpr int maxChannels = 2;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset();
+
+    void setParameters(float newFrequency, float newQuality, float gainInDecibels, const DynamicSettings& settings);
+
+    /**
+     filters channels in place. The detector may point at the same channels
+     (they are read before anything is written) or at a sidechain.
+     */
+    void process(float* const* channels, int numChannels, const float* const* detector, int numDetectorChannels, int numSamples) noexcept;
+
+private:
+    static constexpr float rampInDecibels = 12.f;
+
+    double sampleRate = 44100.0;
+    int maxBlockSize = 0;
+
+    float frequency = 750.f, quality = 1.f;
+    float g = 0.f, kBase = 1.f;                 // tan(pi f / fs) and 1 / Q
+    float staticGainInDecibels = 0.f;
+    DynamicSettings dynamicSettings;
+    float attackCoefficient = 0.f, releaseCoefficient = 0.f;
+
+    struct SVFState
+    {
+        float ic1eq = 0.f, ic2eq = 0.f;
+    };
+
+    std::array<SVFState, maxChannels> states;
+    SVFState detectorState;
+    float envelope = 0.f;
+
+    //one value per sample of the current block
+    std::vector<float> levels, gains, k, m1, a1;
+};
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    LevelMeter.cpp
+
+    Peak, RMS and short-term loudness of a stereo signal, measured on the
+    audio thread and read by the editor.
+
+  ==============================================================================
+*/
+
+#include "LevelMeter.h"
+
+namespace
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    float getSumOfSquares(const float* samples, int numSamples)
+    {
+        float sum = 0.f;
+        int i = 0;
+
+        //scalar up to the first aligned sample, then a register at a time
+        const auto* aligned = Vec::getNextSIMDAlignedPtr(const_cast<float*>(samples));
+        for (; i < numSamples && samples + i < aligned; ++i)
+            sum += samples[i] * samples[i];
+
+        auto sums = Vec::expand(0.f);
+        for (; i + (int)Vec::size() <= numSamples; i += (int)Vec::size())
+        {
+            const auto v = Vec::fromRawArray(samples + i);
+            sums += v * v;
+        }
+
+        sum += sums.sum();
+
+        for (; i < numSamples; ++i)
+            sum += samples[i] * samples[i];
+
+        return sum;
+    }
+
+    float getAbsolutePeak(const float* samples, int numSamples)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax(samples, numSamples);
+        return juce::jmax(-range.getStart(), range.getEnd());
+    }
+
+    void storeMax(std::atomic<float>& target, float value)
+    {
+        auto previous = target.load(std::memory_order_relaxed);
+        while (previous < value && !target.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+//==============================================================================
+void LevelMeter::prepare(double sampleRate)
+{
+    //BS.1770 filters for any sample rate, as in libebur128
+    {
+        const auto f0 = 1681.974450955533, G = 3.999843853973347, Q = 0.7071752369554196;
+        const auto K = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const auto Vh = std::pow(10.0, G / 20.0);
+        const auto Vb = std::pow(Vh, 0.4996667741545416);
+        const auto a0 = 1.0 + K / Q + K * K;
+
+        auto& shelf = kWeighting[0];
+        shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+        shelf.b1 = 2.0 * (K * K - Vh) / a0;
+        shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+        shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+        shelf.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+    {
+        const auto f0 = 38.13547087602444, Q = 0.5003270373238773;
+        const auto K = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const auto a0 = 1.0 + K / Q + K * K;
+
+        auto& highPass = kWeighting[1];
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (K * K - 1.0) / a0;
+        highPass.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+
+    segmentLength = juce::jmax(1, juce::roundToInt(sampleRate * 0.1));
+    reset();
+}
+
+void LevelMeter::reset()
+{
+    kStates = {};
+    current = {};
+    history = {};
+    samplesInSegment = 0;
+    nextSegment = 0;
+    numSegments = 0;
+
+    for (int ch = 0; ch < maxChannels; ++ch)
+    {
+        peaks[(size_t)ch].store(0.f);
+        rms[(size_t)ch].store(0.f);
+    }
+
+    shortTermLoudness.store(minusInfinityLUFS);
+}
+
+float LevelMeter::getPeakAndReset(int channel)
+{
+    return peaks[(size_t)channel].exchange(0.f, std::memory_order_relaxed);
+}
+
+//==============================================================================
+void LevelMeter::process(const juce::AudioBuffer<float>& buffer)
+{
+    const auto numChannels = juce::jmin(maxChannels, buffer.getNumChannels());
+    const auto numSamples = buffer.getNumSamples();
+
+    for (int start = 0; start < numSamples;)
+    {
+        const auto numToProcess = juce::jmin(numSamples - start, segmentLength - samplesInSegment);
+
+        const float* channels[maxChannels] = {};
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            channels[ch] = buffer.getReadPointer(ch, start);
+
+            storeMax(peaks[(size_t)ch], getAbsolutePeak(channels[ch], numToProcess));
+            current.sumOfSquares[(size_t)ch] += getSumOfSquares(channels[ch], numToProcess);
+        }
+
+        processKWeighting(channels, numChannels, numToProcess, current);
+
+        samplesInSegment += numToProcess;
+        start += numToProcess;
+
+        if (samplesInSegment == segmentLength)
+            finishSegment(numChannels);
+    }
+}
+
+void LevelMeter::processKWeighting(const float* const* channels, int numChannels, int numSamples, Segment& segment)
+{
+    if (numChannels <= 0)
+        return;
+
+    DoubleVec b0[2], b1[2], b2[2], a1[2], a2[2], s1[2], s2[2];
+    for (size_t k = 0; k < kWeighting.size(); ++k)
+    {
+        b0[k] = DoubleVec::expand(kWeighting[k].b0);
+        b1[k] = DoubleVec::expand(kWeighting[k].b1);
+        b2[k] = DoubleVec::expand(kWeighting[k].b2);
+        a1[k] = DoubleVec::expand(kWeighting[k].a1);
+        a2[k] = DoubleVec::expand(kWeighting[k].a2);
+        s1[k] = DoubleVec::fromRawArray(kStates[k].s1.data());
+        s2[k] = DoubleVec::fromRawArray(kStates[k].s2.data());
+    }
+
+    auto sums = DoubleVec::expand(0.0);
+    alignas(numLanes * sizeof(double)) std::array<double, numLanes> lanes{};
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            lanes[(size_t)ch] = channels[ch][i];
+
+        auto x = DoubleVec::fromRawArray(lanes.data());
+
+        for (size_t k = 0; k < kWeighting.size(); ++k)
+        {
+            const auto y = b0[k] * x + s1[k];
+            s1[k] = b1[k] * x - a1[k] * y + s2[k];
+            s2[k] = b2[k] * x - a2[k] * y;
+            x = y;
+        }
+
+        sums += x * x;
+    }
+
+    for (size_t k = 0; k < kWeighting.size(); ++k)
+    {
+        s1[k].copyToRawArray(kStates[k].s1.data());
+        s2[k].copyToRawArray(kStates[k].s2.data());
+
+        //keep the states out of the denormal range during silence
+        for (auto* state : { &kStates[k].s1, &kStates[k].s2 })
+            for (auto& value : *state)
+                if (std::abs(value) < 1.0e-15)
+                    value = 0.0;
+    }
+
+    sums.copyToRawArray(lanes.data());
+    for (int ch = 0; ch < numChannels; ++ch)
+        segment.weightedSumOfSquares[(size_t)ch] += lanes[(size_t)ch];
+}
+
+void LevelMeter::finishSegment(int numChannels)
+{
+    history[(size_t)nextSegment] = current;
+    nextSegment = (nextSegment + 1) % loudnessSegments;
+    numSegments = juce::jmin(numSegments + 1, loudnessSegments);
+    current = {};
+    samplesInSegment = 0;
+
+    auto getSegment = [this](int age) -> const Segment&
+    {
+        return history[(size_t)((nextSegment - 1 - age + loudnessSegments) % loudnessSegments)];
+    };
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto count = juce::jmin(rmsSegments, numSegments);
+
+        double sum = 0.0;
+        for (int age = 0; age < count; ++age)
+            sum += getSegment(age).sumOfSquares[(size_t)ch];
+
+        rms[(size_t)ch].store((float)std::sqrt(sum / (double)(count * segmentLength)), std::memory_order_relaxed);
+    }
+
+    //BS.1770: the channel weights of left, right and mono are all 1
+    double weighted = 0.0;
+    for (int age = 0; age < numSegments; ++age)
+        for (int ch = 0; ch < numChannels; ++ch)
+            weighted += getSegment(age).weightedSumOfSquares[(size_t)ch];
+
+    const auto meanSquare = weighted / (double)(numSegments * segmentLength);
+    const auto loudness = meanSquare > 0.0 ? -0.691 + 10.0 * std::log10(meanSquare) : (double)minusInfinityLUFS;
+
+    shortTermLoudness.store((float)juce::jmax((double)minusInfinityLUFS, loudness), std::memory_order_relaxed);
+}
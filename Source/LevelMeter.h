@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+
+    Peak, RMS and short-term loudness of a stereo signal, measured on the
+    audio thread and read by the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/**
+ process() is called from processBlock(). Peak and sum of squares are computed
+ with SIMD. The K-weighting (ITU-R BS.1770 pre-filter and RLB high pass) is a
+ recursion, so it can't be vectorised along time. It runs both channels at once
+ instead, one per lane of a SIMDRegister<double>, and accumulates their energy
+ as it goes.
+
+ The signal is cut into 100 ms segments. Each finished segment publishes
+ the RMS of the last 300 ms and the short-term loudness of the last 3 s to
+ atomics. The peak is held in an atomic until the editor takes it, so no
+ sample peak is ever missed between two meter repaints.
+
+ The getters may be called from any thread.
+ */
+class LevelMeter
+{
+public:
+    static constexpr int maxChannels = 2;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    void process(const juce::AudioBuffer<float>& buffer);
+
+    /** the highest absolute sample since the last call, linear. */
+    float getPeakAndReset(int channel);
+
+    /** linear RMS over the last 300 ms. */
+    float getRMS(int channel) const { return rms[(size_t)channel].load(std::memory_order_relaxed); }
+
+    /** LUFS over the last 3 s, or minusInfinityLUFS while silent. */
+    float getShortTermLoudness() const { return shortTermLoudness.load(std::memory_order_relaxed); }
+
+    static constexpr float minusInfinityLUFS = -100.f;
+
+private:
+    static constexpr int rmsSegments = 3, loudnessSegments = 30;
+
+    struct Biquad
+    {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    //one lane per channel, whatever the register width (2 doubles with SSE/NEON, 4 with AVX);
+    //the lanes past the channels are kept at zero
+    using DoubleVec = juce::dsp::SIMDRegister<double>;
+    static constexpr size_t numLanes = DoubleVec::SIMDNumElements;
+    static_assert(numLanes >= (size_t)maxChannels, "every channel needs a lane");
+
+    struct KWeightingState
+    {
+        alignas(numLanes * sizeof(double)) std::array<double, numLanes> s1{}, s2{};
+    };
+
+    struct Segment
+    {
+        std::array<double, maxChannels> sumOfSquares{}, weightedSumOfSquares{};
+    };
+
+    std::array<Biquad, 2> kWeighting;
+    std::array<KWeightingState, 2> kStates;     // per stage
+
+    int segmentLength = 4800, samplesInSegment = 0;
+    Segment current;
+    std::array<Segment, loudnessSegments> history;
+    int nextSegment = 0, numSegments = 0;
+
+    std::array<std::atomic<float>, maxChannels> peaks{}, rms{};
+    std::atomic<float> shortTermLoudness{ minusInfinityLUFS };
+
+    void processKWeighting(const float* const* channels, int numChannels, int numSamples, Segment& segment);
+    void finishSegment(int numChannels);
+};
@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    MatchEQ.cpp
+
+    Offline analysis that fits the EQ bands so a target file's long-term
+    spectrum matches a reference file's.
+
+  ==============================================================================
+*/
+
+#include "MatchEQ.h"
+
+namespace
+{
+    constexpr int framesPerChunk = 64;
+
+    struct SpectrumJob : juce::ThreadPoolJob
+    {
+        SpectrumJob(std::unique_ptr<juce::AudioFormatReader> r, FFTOrder order, juce::int64 first, juce::int64 end)
+            : juce::ThreadPoolJob("MatchEQ spectrum"),
+            reader(std::move(r)),
+            firstFrame(first),
+            endFrame(end)
+        {
+            generator.setTransformOrder(order);
+            power.assign((size_t)generator.getFFTSize() / 2, 0.0);
+        }
+
+        JobStatus runJob() override
+        {
+            const auto fftSize = generator.getFFTSize();
+            const auto hop = fftSize / 2;
+            const auto numChannels = (int)reader->numChannels;
+
+            juce::AudioBuffer<float> chunk(numChannels, (framesPerChunk - 1) * hop + fftSize);
+            std::vector<float> mono((size_t)chunk.getNumSamples());
+            std::vector<float> magnitudes((size_t)fftSize * 2);
+
+            for (auto frame = firstFrame; frame < endFrame; frame += framesPerChunk)
+            {
+                if (shouldExit())
+                    break;
+
+                const auto numFrames = (int)juce::jmin((juce::int64)framesPerChunk, endFrame - frame);
+                const auto numSamples = (numFrames - 1) * hop + fftSize;
+
+                reader->read(&chunk, 0, numSamples, frame * hop, true, true);
+
+                juce::FloatVectorOperations::copy(mono.data(), chunk.getReadPointer(0), numSamples);
+                for (int ch = 1; ch < numChannels; ++ch)
+                    juce::FloatVectorOperations::add(mono.data(), chunk.getReadPointer(ch), numSamples);
+                juce::FloatVectorOperations::multiply(mono.data(), 1.f / (float)numChannels, numSamples);
+
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    generator.computeMagnitudes(mono.data() + i * hop, magnitudes.data());
+
+                    for (size_t bin = 0; bin < power.size(); ++bin)
+                        power[bin] += (double)magnitudes[bin] * (double)magnitudes[bin];
+                }
+            }
+
+            return jobHasFinished;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        FFTDataGenerator<std::vector<float>> generator;
+        juce::int64 firstFrame, endFrame;
+        std::vector<double> power;
+    };
+
+    //==============================================================================
+    //the fit is done on a log-spaced grid of points, one dB value per band per point
+    struct FitGrid
+    {
+        std::vector<double> freqs, target;
+        double sampleRate = 44100.0;
+    };
+
+    double getSmoothedLevel(const MatchEQ::Spectrum& spectrum, double freq)
+    {
+        const auto binWidth = spectrum.sampleRate / spectrum.fftSize;
+        const auto numBins = (int)spectrum.power.size();
+
+        //a third of an octave around freq, but at least one bin
+        auto lowBin = juce::jlimit(1, numBins - 1, (int)std::floor(freq * std::pow(2.0, -1.0 / 6.0) / binWidth));
+        auto highBin = juce::jlimit(lowBin, numBins - 1, (int)std::ceil(freq * std::pow(2.0, 1.0 / 6.0) / binWidth));
+
+        double sum = 0.0;
+        for (int bin = lowBin; bin <= highBin; ++bin)
+            sum += spectrum.power[(size_t)bin];
+
+        return 10.0 * std::log10(sum / (highBin - lowBin + 1) + 1.0e-20);
+    }
+
+    double getMagnitudeInDecibels(const Coefficients& coefficients, double freq, double sampleRate)
+    {
+        return juce::Decibels::gainToDecibels(coefficients->getMagnitudeForFrequency(freq, sampleRate), -60.0);
+    }
+
+    void evaluatePeak(const ChainSettings& settings, const FitGrid& grid, std::vector<double>& out)
+    {
+        auto coefficients = makePeakFilter(settings, grid.sampleRate);
+        for (size_t i = 0; i < grid.freqs.size(); ++i)
+            out[i] = getMagnitudeInDecibels(coefficients, grid.freqs[i], grid.sampleRate);
+    }
+
+    template<typename CutCoefficientsType>
+    void evaluateCut(const CutCoefficientsType& coefficients, Slope slope, const FitGrid& grid, std::vector<double>& out)
+    {
+        for (size_t i = 0; i < grid.freqs.size(); ++i)
+        {
+            double magnitude = 0.0;
+            for (int stage = 0; stage <= slope; ++stage)
+                magnitude += getMagnitudeInDecibels(coefficients[stage], grid.freqs[i], grid.sampleRate);
+
+            out[i] = juce::jmax(-60.0, magnitude);
+        }
+    }
+
+    void evaluateLowCut(const ChainSettings& settings, const FitGrid& grid, std::vector<double>& out)
+    {
+        evaluateCut(makeLowCutFilter(settings, grid.sampleRate), settings.lowCutSlope, grid, out);
+    }
+
+    void evaluateHighCut(const ChainSettings& settings, const FitGrid& grid, std::vector<double>& out)
+    {
+        evaluateCut(makeHighCutFilter(settings, grid.sampleRate), settings.highCutSlope, grid, out);
+    }
+
+    double getSquaredError(const FitGrid& grid, const std::vector<double>& lowCut, const std::vector<double>& peak, const std::vector<double>& highCut)
+    {
+        double error = 0.0;
+        for (size_t i = 0; i < grid.freqs.size(); ++i)
+        {
+            const auto d = juce::jmax(-60.0, lowCut[i] + peak[i] + highCut[i]) - grid.target[i];
+            error += d * d;
+        }
+
+        return error;
+    }
+
+    std::vector<float> makeLogSteps(float start, float end, int numSteps)
+    {
+        std::vector<float> steps;
+        for (int i = 0; i < numSteps; ++i)
+            steps.push_back((float)std::round(juce::mapToLog10((float)i / (numSteps - 1), start, end)));
+
+        return steps;
+    }
+}
+
+//==============================================================================
+MatchEQ::Spectrum MatchEQ::computeAverageSpectrum(const juce::File& file,
+    juce::AudioFormatManager& formatManager,
+    FFTOrder order,
+    int numThreads)
+{
+    Spectrum spectrum;
+
+    std::unique_ptr<juce::AudioFormatReader> firstReader(formatManager.createReaderFor(file));
+    if (firstReader == nullptr || firstReader->numChannels == 0)
+        return spectrum;
+
+    const auto fftSize = 1 << order;
+    const auto hop = fftSize / 2;
+    const auto length = firstReader->lengthInSamples;
+
+    spectrum.sampleRate = firstReader->sampleRate;
+    spectrum.fftSize = fftSize;
+    spectrum.power.assign((size_t)fftSize / 2, 0.0);
+
+    if (length < fftSize)
+        return spectrum;
+
+    const auto totalFrames = (length - fftSize) / hop + 1;
+    numThreads = (int)juce::jlimit((juce::int64)1, totalFrames, (juce::int64)numThreads);
+    const auto framesPerJob = (totalFrames + numThreads - 1) / numThreads;
+
+    //every job gets its own reader, so the reads run in parallel too
+    juce::OwnedArray<SpectrumJob> jobs;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        auto reader = i == 0 ? std::move(firstReader)
+                             : std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+        if (reader == nullptr)
+            return spectrum;
+
+        const auto first = juce::jmin(totalFrames, i * framesPerJob);
+        jobs.add(new SpectrumJob(std::move(reader), order, first, juce::jmin(totalFrames, first + framesPerJob)));
+    }
+
+    {
+        juce::ThreadPool pool(numThreads);
+        for (auto* job : jobs)
+            pool.addJob(job, false);
+
+        for (auto* job : jobs)
+            pool.waitForJobToFinish(job, -1);
+    }
+
+    for (auto* job : jobs)
+        for (size_t bin = 0; bin < spectrum.power.size(); ++bin)
+            spectrum.power[bin] += job->power[bin];
+
+    for (auto& p : spectrum.power)
+        p /= (double)totalFrames;
+
+    spectrum.numFrames = totalFrames;
+    return spectrum;
+}
+
+MatchEQ::Result MatchEQ::fitChainSettings(const Spectrum& reference, const Spectrum& target, DesignMode designMode)
+{
+    jassert(reference.isValid() && target.isValid());
+
+    Result result;
+    result.settings.designMode = designMode;
+    result.settings.lowCutFreq = 20.f;
+    result.settings.highCutFreq = 20000.f;
+
+    //==============================================================================
+    FitGrid grid;
+    grid.sampleRate = target.sampleRate;
+
+    const auto topFreq = juce::jmin(20000.0, 0.45 * juce::jmin(reference.sampleRate, target.sampleRate));
+    const int numPoints = 96;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto freq = juce::mapToLog10((double)i / (numPoints - 1), 20.0, topFreq);
+        const auto difference = getSmoothedLevel(reference, freq) - getSmoothedLevel(target, freq);
+
+        grid.freqs.push_back(freq);
+        grid.target.push_back(juce::jlimit(-60.0, 24.0, difference));
+    }
+
+    //the bands can't change the overall level, so match the median of the mid band first
+    std::vector<double> midBand;
+    for (size_t i = 0; i < grid.freqs.size(); ++i)
+        if (grid.freqs[i] >= 200.0 && grid.freqs[i] <= 5000.0)
+            midBand.push_back(grid.target[i]);
+
+    if (!midBand.empty())
+    {
+        std::nth_element(midBand.begin(), midBand.begin() + midBand.size() / 2, midBand.end());
+        result.levelOffsetInDecibels = (float)midBand[midBand.size() / 2];
+    }
+
+    for (auto& t : grid.target)
+        t = juce::jmax(-60.0, t - result.levelOffsetInDecibels);
+
+    //==============================================================================
+    //start the peak on the largest deviation between the cuts' usual territory
+    auto& s = result.settings;
+    {
+        size_t largest = 0;
+        for (size_t i = 0; i < grid.freqs.size(); ++i)
+            if (grid.freqs[i] > 40.0 && grid.freqs[i] < 16000.0 && std::abs(grid.target[i]) > std::abs(grid.target[largest]))
+                largest = i;
+
+        s.peakFreq = (float)std::round(grid.freqs[largest]);
+        s.peakGainInDecibels = juce::jlimit(-24.f, 24.f, (float)std::round(grid.target[largest] * 2.0) * 0.5f);
+        s.peakQuality = 1.1f;
+    }
+
+    std::vector<double> lowCut(grid.freqs.size()), peak(grid.freqs.size()), highCut(grid.freqs.size());
+    evaluateLowCut(s, grid, lowCut);
+    evaluatePeak(s, grid, peak);
+    evaluateHighCut(s, grid, highCut);
+
+    auto bestError = getSquaredError(grid, lowCut, peak, highCut);
+
+    //tries every candidate for one parameter and keeps the best, re-evaluating only that band
+    auto scan = [&](auto& parameter, const auto& candidates, auto evaluateBand, std::vector<double>& band)
+    {
+        auto bestValue = parameter;
+        auto bestBand = band;
+
+        for (auto candidate : candidates)
+        {
+            parameter = candidate;
+            evaluateBand(s, grid, band);
+
+            const auto error = getSquaredError(grid, lowCut, peak, highCut);
+            if (error < bestError)
+            {
+                bestError = error;
+                bestValue = candidate;
+                bestBand = band;
+            }
+        }
+
+        parameter = bestValue;
+        band = bestBand;
+    };
+
+    //a coarse log-spaced subset of the frequencies, rounded to the parameters' 1 Hz step, so every
+    //candidate is a value the parameters can hold; the cuts only search their own half of the range.
+    //Gain and Q do use the parameters' own 0.5 steps
+    const auto lowCutFreqs = makeLogSteps(20.f, 1000.f, 64);
+    const auto highCutFreqs = makeLogSteps(1000.f, 20000.f, 64);
+    const auto peakFreqs = makeLogSteps(20.f, 20000.f, 96);
+    const std::vector<Slope> slopes{ Slope_12, Slope_24, Slope_36, Slope_48 };
+
+    std::vector<float> gains, qualities;
+    for (float g = -24.f; g <= 24.f; g += 0.5f)
+        gains.push_back(g);
+    for (float q = 0.1f; q <= 10.f; q += 0.5f)
+        qualities.push_back(q);
+
+    for (int pass = 0; pass < 4; ++pass)
+    {
+        scan(s.lowCutFreq, lowCutFreqs, evaluateLowCut, lowCut);
+        scan(s.lowCutSlope, slopes, evaluateLowCut, lowCut);
+        scan(s.highCutFreq, highCutFreqs, evaluateHighCut, highCut);
+        scan(s.highCutSlope, slopes, evaluateHighCut, highCut);
+        scan(s.peakFreq, peakFreqs, evaluatePeak, peak);
+        scan(s.peakGainInDecibels, gains, evaluatePeak, peak);
+        scan(s.peakQuality, qualities, evaluatePeak, peak);
+    }
+
+    result.rmsErrorInDecibels = (float)std::sqrt(bestError / (double)grid.freqs.size());
+    return result;
+}
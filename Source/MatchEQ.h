@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    MatchEQ.h
+
+    Offline analysis that fits the EQ bands so a target file's long-term
+    spectrum matches a reference file's.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "Analyzer.h"
+
+struct MatchEQ
+{
+    /**
+     long-term average power spectrum of a file, mixed down to mono.
+     */
+    struct Spectrum
+    {
+        std::vector<double> power;   // mean power of each of the fftSize / 2 bins
+        double sampleRate = 0.0;
+        int fftSize = 0;
+        juce::int64 numFrames = 0;
+
+        bool isValid() const { return numFrames > 0; }
+    };
+
+    struct Result
+    {
+        ChainSettings settings;
+
+        // broadband level difference (reference - target), taken out before fitting
+        float levelOffsetInDecibels = 0.f;
+
+        // how far the fitted bands are from the difference curve, on average
+        float rmsErrorInDecibels = 0.f;
+    };
+
+    /**
+     streams the file through Blackman-Harris windowed FFTs with 50% overlap and
+     averages the power of every frame. The file is cut into one contiguous range
+     of frames per thread and each range is read in fixed-size chunks by its own
+     reader, so memory only depends on the FFT size and the number of threads.
+     Returns an invalid Spectrum if the file can't be read or is shorter than one FFT.
+     */
+    static Spectrum computeAverageSpectrum(const juce::File& file,
+        juce::AudioFormatManager& formatManager,
+        FFTOrder order,
+        int numThreads);
+
+    /**
+     fits LowCut, Peak and HighCut to the 1/3-octave smoothed difference between
+     the two spectra, i.e. the settings that bring target closer to reference.
+     The settings are snapped to the steps of the plugin's parameters.
+     */
+    static Result fitChainSettings(const Spectrum& reference,
+        const Spectrum& target,
+        DesignMode designMode = Design_Bilinear);
+};
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    MatchedFilterDesign.cpp
+
+    Biquads whose magnitude matches the analog prototype up to Nyquist.
+
+  ==============================================================================
+*/
+
+#include "MatchedFilterDesign.h"
+
+namespace
+{
+    struct MatchedPoles
+    {
+        double a1, a2;
+
+        // (1 + a1 + a2)^2, (1 - a1 + a2)^2 and -4 a2: the denominator's squared magnitude terms
+        double A0, A1, A2;
+
+        // cos^2(w0/2), sin^2(w0/2) and their product times 4
+        double phi0, phi1, phi2;
+    };
+
+    MatchedPoles matchPoles(double sampleRate, double frequency, double Q)
+    {
+        //stay just below Nyquist so the phi1 terms never vanish
+        const auto w0 = juce::MathConstants<double>::twoPi * juce::jmin(frequency, 0.499 * sampleRate) / sampleRate;
+        const auto q = 0.5 / Q;
+
+        MatchedPoles p;
+        if (q <= 1.0)
+            p.a1 = -2.0 * std::exp(-q * w0) * std::cos(std::sqrt(1.0 - q * q) * w0);
+        else
+            p.a1 = -2.0 * std::exp(-q * w0) * std::cosh(std::sqrt(q * q - 1.0) * w0);
+
+        p.a2 = std::exp(-2.0 * q * w0);
+
+        p.A0 = (1.0 + p.a1 + p.a2) * (1.0 + p.a1 + p.a2);
+        p.A1 = (1.0 - p.a1 + p.a2) * (1.0 - p.a1 + p.a2);
+        p.A2 = -4.0 * p.a2;
+
+        const auto s = std::sin(0.5 * w0);
+        p.phi1 = s * s;
+        p.phi0 = 1.0 - p.phi1;
+        p.phi2 = 4.0 * p.phi0 * p.phi1;
+
+        return p;
+    }
+
+    MatchedFilterDesign::CoefficientsPtr makeBiquad(double b0, double b1, double b2, double a1, double a2)
+    {
+        return new juce::dsp::IIR::Coefficients<float>((float)b0, (float)b1, (float)b2, 1.f, (float)a1, (float)a2);
+    }
+
+    //Q of each biquad of an even order Butterworth cascade
+    double getButterworthQ(int order, int section)
+    {
+        return 1.0 / (2.0 * std::cos(juce::MathConstants<double>::pi * (2 * section + 1) / (2.0 * order)));
+    }
+
+    double safeSqrt(double x)
+    {
+        return std::sqrt(juce::jmax(0.0, x));
+    }
+}
+
+MatchedFilterDesign::CoefficientsPtr MatchedFilterDesign::makeLowPass(double sampleRate, double frequency, double Q)
+{
+    const auto p = matchPoles(sampleRate, frequency, Q);
+
+    const auto R1 = (p.A0 * p.phi0 + p.A1 * p.phi1 + p.A2 * p.phi2) * Q * Q;
+    const auto B0 = p.A0;
+    const auto B1 = (R1 - B0 * p.phi0) / p.phi1;
+
+    const auto b0 = 0.5 * (std::sqrt(B0) + safeSqrt(B1));
+    const auto b1 = std::sqrt(B0) - b0;
+
+    return makeBiquad(b0, b1, 0.0, p.a1, p.a2);
+}
+
+MatchedFilterDesign::CoefficientsPtr MatchedFilterDesign::makeHighPass(double sampleRate, double frequency, double Q)
+{
+    const auto p = matchPoles(sampleRate, frequency, Q);
+
+    const auto b0 = Q * safeSqrt(p.A0 * p.phi0 + p.A1 * p.phi1 + p.A2 * p.phi2) / (4.0 * p.phi1);
+
+    return makeBiquad(b0, -2.0 * b0, b0, p.a1, p.a2);
+}
+
+MatchedFilterDesign::CoefficientsPtr MatchedFilterDesign::makePeakFilter(double sampleRate, double frequency, double Q, double gainFactor)
+{
+    jassert(gainFactor > 0.0);
+
+    //the poles belong to the prototype's denominator, s^2 + s / (Q sqrt(G)) + 1
+    const auto G = gainFactor;
+    const auto p = matchPoles(sampleRate, frequency, Q * std::sqrt(G));
+
+    const auto R1 = (p.A0 * p.phi0 + p.A1 * p.phi1 + p.A2 * p.phi2) * G * G;
+    const auto R2 = (-p.A0 + p.A1 + 4.0 * (p.phi0 - p.phi1) * p.A2) * G * G;
+
+    const auto B0 = p.A0;
+    const auto B2 = (R1 - R2 * p.phi1 - B0) / (4.0 * p.phi1 * p.phi1);
+    const auto B1 = R2 + B0 + 4.0 * (p.phi1 - p.phi0) * B2;
+
+    const auto W = 0.5 * (std::sqrt(B0) + safeSqrt(B1));
+    const auto b0 = 0.5 * (W + safeSqrt(W * W + B2));
+    const auto b1 = 0.5 * (std::sqrt(B0) - safeSqrt(B1));
+    const auto b2 = -B2 / (4.0 * b0);
+
+    return makeBiquad(b0, b1, b2, p.a1, p.a2);
+}
+
+MatchedFilterDesign::CoefficientsArray MatchedFilterDesign::designLowpassButterworth(double frequency, double sampleRate, int order)
+{
+    jassert(order > 0 && order % 2 == 0);
+
+    CoefficientsArray sections;
+    for (int i = 0; i < order / 2; ++i)
+        sections.add(makeLowPass(sampleRate, frequency, getButterworthQ(order, i)));
+
+    return sections;
+}
+
+MatchedFilterDesign::CoefficientsArray MatchedFilterDesign::designHighpassButterworth(double frequency, double sampleRate, int order)
+{
+    jassert(order > 0 && order % 2 == 0);
+
+    CoefficientsArray sections;
+    for (int i = 0; i < order / 2; ++i)
+        sections.add(makeHighPass(sampleRate, frequency, getButterworthQ(order, i)));
+
+    return sections;
+}
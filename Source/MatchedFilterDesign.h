@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    MatchedFilterDesign.h
+
+    Biquads whose magnitude matches the analog prototype up to Nyquist.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ The bilinear transform squeezes the whole analog frequency axis below
+ Nyquist, so peaks and cutoffs in the top octave come out narrower and
+ "cramped". These designs follow M. Vicanek, "Matched Second Order Digital
+ Filters" (2016): the poles are matched exactly (impulse invariance) and the
+ zeros are then solved so the magnitude equals the analog one at DC, at the
+ centre frequency and at Nyquist. The result costs one plain biquad per
+ section at the host rate, with no oversampling.
+
+ The analog prototypes are the same as juce::dsp::IIR::Coefficients'
+ makePeakFilter() and the Butterworth cascades of juce::dsp::FilterDesign.
+ */
+namespace MatchedFilterDesign
+{
+    using CoefficientsPtr = juce::dsp::IIR::Coefficients<float>::Ptr;
+    using CoefficientsArray = juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>>;
+
+    CoefficientsPtr makeLowPass(double sampleRate, double frequency, double Q);
+    CoefficientsPtr makeHighPass(double sampleRate, double frequency, double Q);
+
+    /** gainFactor is the linear gain at the centre frequency, as for IIR::Coefficients::makePeakFilter(). */
+    CoefficientsPtr makePeakFilter(double sampleRate, double frequency, double Q, double gainFactor);
+
+    /** order must be even; returns order / 2 biquads, like FilterDesign's HighOrderButterworthMethod. */
+    CoefficientsArray designLowpassButterworth(double frequency, double sampleRate, int order);
+    CoefficientsArray designHighpassButterworth(double frequency, double sampleRate, int order);
+}
@@ -0,0 +1,275 @@
+/*
+  ==============================================================================
+
+    ParallelRender.cpp
+
+    Offline rendering of long signals through the EQ on all cores at once.
+
+  ==============================================================================
+*/
+
+#include "ParallelRender.h"
+
+ParallelIIRRenderer::ParallelIIRRenderer(const ChainSettings& chainSettings, double sampleRate, int numChannels, int numThreads, int newChunkSize)
+    : chunkSize(newChunkSize),
+    pool(juce::jmax(1, numThreads))
+{
+    jassert(chunkSize > 0);
+
+    //the active stages of a MonoChain, in its order
+    auto addStage = [this](const Coefficients& coefficients)
+    {
+        const auto* c = coefficients->getRawCoefficients();
+        stages.push_back({ c[0], c[1], c[2], c[3], c[4] });
+    };
+
+    auto lowCut = makeLowCutFilter(chainSettings, sampleRate);
+    for (int i = 0; i <= chainSettings.lowCutSlope; ++i)
+        addStage(lowCut[i]);
+
+    addStage(makePeakFilter(chainSettings, sampleRate));
+
+    auto highCut = makeHighCutFilter(chainSettings, sampleRate);
+    for (int i = 0; i <= chainSettings.highCutSlope; ++i)
+        addStage(highCut[i]);
+
+    stateSize = 2 * (int)stages.size();
+
+    //column i of A is where one sample of zero input takes the unit state e_i
+    transition.assign((size_t)(stateSize * stateSize), 0.0);
+    for (int i = 0; i < stateSize; ++i)
+    {
+        State x((size_t)stateSize, 0.0);
+        x[(size_t)i] = 1.0;
+
+        double input = 0.0;
+        for (size_t k = 0; k < stages.size(); ++k)
+        {
+            const auto& q = stages[k];
+            auto& s1 = x[2 * k];
+            auto& s2 = x[2 * k + 1];
+
+            const auto output = q.b0 * input + s1;
+            s1 = q.b1 * input - q.a1 * output + s2;
+            s2 = q.b2 * input - q.a2 * output;
+            input = output;
+        }
+
+        for (int row = 0; row < stateSize; ++row)
+            transition[(size_t)(row * stateSize + i)] = x[(size_t)row];
+    }
+
+    channelStates.assign((size_t)numChannels, State((size_t)stateSize, 0.0));
+
+    //the free response of each chunk runs for about one decay length, so a chunk spans several
+    chunkSize = juce::jmax(chunkSize, minDecaysPerChunk * getDecayLength());
+}
+
+int ParallelIIRRenderer::getDecayLength() const
+{
+    double slowestRadius = 0.0;
+    for (const auto& q : stages)
+    {
+        //the poles are the roots of z^2 + a1 z + a2
+        const double a1 = q.a1, a2 = q.a2;
+        const auto discriminant = a1 * a1 - 4.0 * a2;
+
+        const auto radius = discriminant < 0.0
+            ? std::sqrt(a2)                                     // a conjugate pair
+            : (std::abs(a1) + std::sqrt(discriminant)) * 0.5;   // the larger real one
+
+        slowestRadius = juce::jmax(slowestRadius, radius);
+    }
+
+    //nothing rings (or a pole sits on the unit circle, and nothing decays): keep the requested size
+    if (slowestRadius <= 0.0 || slowestRadius >= 1.0)
+        return 0;
+
+    const auto length = std::log(freeResponseThreshold) / std::log(slowestRadius);
+    return (int)std::ceil(juce::jmin(length, (double)(1 << 24)));
+}
+
+ParallelIIRRenderer::~ParallelIIRRenderer()
+{
+    pool.removeAllJobs(true, -1);
+}
+
+void ParallelIIRRenderer::reset()
+{
+    for (auto& state : channelStates)
+        std::fill(state.begin(), state.end(), 0.0);
+}
+
+//==============================================================================
+void ParallelIIRRenderer::process(juce::AudioBuffer<float>& segment)
+{
+    jassert(segment.getNumChannels() <= (int)channelStates.size());
+
+    const auto numChannels = segment.getNumChannels();
+    const auto numSamples = segment.getNumSamples();
+    const auto numChunks = (numSamples + chunkSize - 1) / chunkSize;
+
+    if (numSamples == 0)
+        return;
+
+    auto getChunkLength = [=](int chunk) { return juce::jmin(chunkSize, numSamples - chunk * chunkSize); };
+
+    //1. zero-state responses, all chunks of all channels at once
+    std::vector<State> endStates((size_t)(numChannels * numChunks));
+    runInParallel(numChannels * numChunks, [&](int task)
+        {
+            const auto channel = task / numChunks, chunk = task % numChunks;
+            filterFromZeroState(segment.getWritePointer(channel, chunk * chunkSize), getChunkLength(chunk), endStates[(size_t)task]);
+        });
+
+    //2. the scan: the true start state of every chunk
+    std::vector<State> startStates((size_t)(numChannels * numChunks));
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& state = channelStates[(size_t)channel];
+
+        for (int chunk = 0; chunk < numChunks; ++chunk)
+        {
+            const auto task = (size_t)(channel * numChunks + chunk);
+            startStates[task] = state;
+
+            state = apply(getTransitionPower(getChunkLength(chunk)), state);
+            for (int i = 0; i < stateSize; ++i)
+                state[(size_t)i] += endStates[task][(size_t)i];
+        }
+    }
+
+    //3. add each start state's free response
+    runInParallel(numChannels * numChunks, [&](int task)
+        {
+            const auto channel = task / numChunks, chunk = task % numChunks;
+            addFreeResponse(segment.getWritePointer(channel, chunk * chunkSize), getChunkLength(chunk), startStates[(size_t)task]);
+        });
+}
+
+void ParallelIIRRenderer::filterFromZeroState(float* samples, int numSamples, State& endState) const
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    endState.assign((size_t)stateSize, 0.0);
+
+    //stage by stage over the whole chunk, like MonoChain
+    for (size_t k = 0; k < stages.size(); ++k)
+    {
+        const auto q = stages[k];
+        float s1 = 0.f, s2 = 0.f;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = samples[i];
+            const auto output = (input * q.b0) + s1;
+            s1 = (input * q.b1) - (output * q.a1) + s2;
+            s2 = (input * q.b2) - (output * q.a2);
+            samples[i] = output;
+        }
+
+        endState[2 * k] = s1;
+        endState[2 * k + 1] = s2;
+    }
+}
+
+void ParallelIIRRenderer::addFreeResponse(float* samples, int numSamples, State state) const
+{
+    constexpr int checkInterval = 32;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (i % checkInterval == 0)
+        {
+            double largest = 0.0;
+            for (auto s : state)
+                largest = juce::jmax(largest, std::abs(s));
+
+            if (largest < freeResponseThreshold)
+                return;
+        }
+
+        double input = 0.0;
+        for (size_t k = 0; k < stages.size(); ++k)
+        {
+            const auto& q = stages[k];
+            auto& s1 = state[2 * k];
+            auto& s2 = state[2 * k + 1];
+
+            const auto output = q.b0 * input + s1;
+            s1 = q.b1 * input - q.a1 * output + s2;
+            s2 = q.b2 * input - q.a2 * output;
+            input = output;
+        }
+
+        samples[i] += (float)input;
+    }
+}
+
+//==============================================================================
+const ParallelIIRRenderer::Matrix& ParallelIIRRenderer::getTransitionPower(int numSamples)
+{
+    auto found = transitionPowers.find(numSamples);
+    if (found != transitionPowers.end())
+        return found->second;
+
+    //A^n by repeated squaring
+    Matrix result((size_t)(stateSize * stateSize), 0.0);
+    for (int i = 0; i < stateSize; ++i)
+        result[(size_t)(i * stateSize + i)] = 1.0;
+
+    auto power = transition;
+    for (auto n = numSamples; n > 0; n >>= 1)
+    {
+        if (n & 1)
+            result = multiply(result, power);
+
+        power = multiply(power, power);
+    }
+
+    return transitionPowers[numSamples] = std::move(result);
+}
+
+ParallelIIRRenderer::Matrix ParallelIIRRenderer::multiply(const Matrix& x, const Matrix& y) const
+{
+    Matrix result((size_t)(stateSize * stateSize), 0.0);
+    for (int row = 0; row < stateSize; ++row)
+        for (int k = 0; k < stateSize; ++k)
+        {
+            const auto xk = x[(size_t)(row * stateSize + k)];
+            for (int col = 0; col < stateSize; ++col)
+                result[(size_t)(row * stateSize + col)] += xk * y[(size_t)(k * stateSize + col)];
+        }
+
+    return result;
+}
+
+ParallelIIRRenderer::State ParallelIIRRenderer::apply(const Matrix& m, const State& x) const
+{
+    State result((size_t)stateSize, 0.0);
+    for (int row = 0; row < stateSize; ++row)
+        for (int col = 0; col < stateSize; ++col)
+            result[(size_t)row] += m[(size_t)(row * stateSize + col)] * x[(size_t)col];
+
+    return result;
+}
+
+template<typename Function>
+void ParallelIIRRenderer::runInParallel(int numTasks, Function&& task)
+{
+    std::atomic<int> remaining{ numTasks };
+    juce::WaitableEvent finished;
+
+    for (int i = 0; i < numTasks; ++i)
+    {
+        pool.addJob([&, i]
+            {
+                task(i);
+                if (--remaining == 0)
+                    finished.signal();
+            });
+    }
+
+    if (numTasks > 0)
+        finished.wait(-1);
+}
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    ParallelRender.h
+
+    Offline rendering of long signals through the EQ on all cores at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+ An IIR cascade is sequential in time, but it is also linear: the output of a
+ chunk is its zero-state response plus the free response of whatever state the
+ previous chunk left behind. process() uses that to filter long segments on
+ every core:
+
+ 1. every chunk of every channel is filtered in parallel from a zero state,
+    exactly as a MonoChain would (float, transposed direct form II);
+ 2. per channel, the true start state of each chunk is found with a cheap scan
+    over the chunks: x[k+1] = A^L x[k] + f[k], where A is the cascade's
+    one-sample state transition and f[k] the chunk's zero-state end state;
+ 3. every chunk then adds the free response of its start state, again in
+    parallel. That response decays, so it only runs until all states are
+    below 1e-12, but a slow resonant pole takes long to get there: the
+    Q = 2.56 section of a Slope_48 cut at 40 Hz needs about 0.6 s, some 29k
+    samples at 48 kHz. So chunks are made at least minDecaysPerChunk times
+    as long as the slowest pole takes, which keeps this pass a fraction of
+    the zero-state one.
+
+ The state carries over between calls, so a file can be rendered in segments.
+ The output matches sequential MonoChain processing to within float rounding:
+ for input in [-1, 1] the difference stays around 1e-6 and the tool's --verify
+ option fails beyond 1e-4.
+ */
+class ParallelIIRRenderer
+{
+public:
+    /** chunkSize is a minimum; it is raised for settings whose free response decays slowly. */
+    ParallelIIRRenderer(const ChainSettings& chainSettings, double sampleRate, int numChannels, int numThreads, int chunkSize = 1 << 16);
+    ~ParallelIIRRenderer();
+
+    int getChunkSize() const { return chunkSize; }
+
+    /** filters every channel of segment in place, continuing from the previous call. */
+    void process(juce::AudioBuffer<float>& segment);
+
+    void reset();
+
+private:
+    struct Biquad
+    {
+        float b0, b1, b2, a1, a2;
+    };
+
+    static constexpr double freeResponseThreshold = 1.0e-12;
+    static constexpr int minDecaysPerChunk = 4;
+
+    /** samples until the slowest pole of the cascade has decayed by freeResponseThreshold. */
+    int getDecayLength() const;
+
+    using Matrix = std::vector<double>;   // row major, stateSize x stateSize
+    using State = std::vector<double>;    // s1, s2 of every stage, in cascade order
+
+    std::vector<Biquad> stages;
+    int stateSize = 0, chunkSize = 0;
+    Matrix transition;                    // A, one sample of zero input
+    std::map<int, Matrix> transitionPowers;
+
+    std::vector<State> channelStates;
+    juce::ThreadPool pool;
+
+    const Matrix& getTransitionPower(int numSamples);
+    Matrix multiply(const Matrix& x, const Matrix& y) const;
+    State apply(const Matrix& m, const State& x) const;
+
+    void filterFromZeroState(float* samples, int numSamples, State& endState) const;
+    void addFreeResponse(float* samples, int numSamples, State state) const;
+
+    template<typename Function>
+    void runInParallel(int numTasks, Function&& task);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelIIRRenderer)
+};
@@ -14,117 +14,140 @@ ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p)
     : audioProcessor(p),
     leftChannelFifo(&audioProcessor.leftChannelFifo)
 {
-    const auto& params = audioProcessor.getParameters();
-    for (auto param : params)
-    {
-        param->addListener(this);
-    }
+    audioProcessor.addAnalyzerConsumer();
 
-    leftChannelFFTDataGenerator.changeOrder(FFTOrder::order4096);
-    monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+    for (auto* param : audioProcessor.getParameters())
+        param->addListener(this);
 
-    startTimerHz(60);
+    setOpaque(true);
+    startTimerHz(activeRefreshRateHz);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
-    const auto& params = audioProcessor.getParameters();
-    for (auto param : params)
-    {
+    for (auto* param : audioProcessor.getParameters())
         param->removeListener(this);
-    }
+
+    audioProcessor.removeAnalyzerConsumer();
 }
 
-void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue)
+void ResponseCurveComponent::parameterValueChanged(int, float)
 {
-    parametersChanged.set(true);
+    //may come from the audio thread (automation), so only raise a flag
+    parametersChanged = true;
 }
 
 void ResponseCurveComponent::timerCallback()
 {
-    juce::AudioBuffer<float> tempIncomingBuffer;
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
-    {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer))
-        {
-            auto size = tempIncomingBuffer.getNumSamples();
+    SIMPLEEQ_TRACE_SCOPE("timerCallback");
 
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                monoBuffer.getReadPointer(0, size),
-                monoBuffer.getNumSamples() - size);
+    bool hasNewAnalyzerData = false;
 
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                tempIncomingBuffer.getReadPointer(0, 0),
-                size);
+    produceAnalyzerFrame();
 
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
-        }
-    }
+    if (generateAnalyzerPath())
+        hasNewAnalyzerData = true;
 
+    //the processor designs once per change and publishes the result; a new editor picks up the current one
+    audioProcessor.pullCoefficientSnapshot();
+    const auto version = audioProcessor.getCoefficientSnapshot().version;
 
-    auto bounds = getLocalBounds();
-    const auto fftBounds = bounds.removeFromTop(bounds.getHeight()*0.85).toFloat();
-    const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
-    const auto binWidth = audioProcessor.getSampleRate() / (double)fftSize;
+    if (parametersChanged.exchange(false))
+    {
+        parameterSnapshot = audioProcessor.designCoefficientSnapshot();
+        drawParameterSnapshot = true;
+        snapshotVersionAtParameterChange = version;
+        responseCurveNeedsRedraw = true;
+        hasNewAnalyzerData = true;
+    }
 
-    while (leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
+    if (version != drawnSnapshotVersion)
     {
-        std::vector<float> fftData;
-        if (leftChannelFFTDataGenerator.getFFTData(fftData))
-        {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
-        }
+        drawnSnapshotVersion = version;
+
+        //published after the last change, so the audio thread has caught up with the parameters
+        if (version != snapshotVersionAtParameterChange)
+            drawParameterSnapshot = false;
+
+        responseCurveNeedsRedraw = true;
+        hasNewAnalyzerData = true;
     }
 
-    while (pathProducer.getNumPathsAvailable() > 0)
+    if (hasNewAnalyzerData)
     {
-        pathProducer.getPath(leftChannelFFTPath);
+        if (idleTicks >= idleTicksBeforeBackoff)
+            startTimerHz(activeRefreshRateHz);
+
+        idleTicks = 0;
+        repaint();
     }
+    else if (++idleTicks == idleTicksBeforeBackoff)
+    {
+        startTimerHz(idleRefreshRateHz);
+    }
+}
+
+void ResponseCurveComponent::resized()
+{
+    responseCurveNeedsRedraw = true;
+}
 
-    if (parametersChanged.compareAndSetBool(false, true))
+bool ResponseCurveComponent::produceAnalyzerFrame()
+{
+    //the low band's decimation and the bin layout depend on the sample rate
+    const auto sampleRate = audioProcessor.getSampleRate();
+    if (sampleRate > 0 && sampleRate != leftChannelFFTDataGenerator.getSampleRate())
+        leftChannelFFTDataGenerator.prepare(sampleRate);
+
+    //only the newest FFT frame is ever drawn, so shift every pending buffer in and transform once
+    bool hasNewSamples = false;
+
+    juce::AudioBuffer<float> tempIncomingBuffer;
+    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
     {
-        auto chainSettings = getChainSetting(audioProcessor.apvts);
-        auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-        updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer) && leftChannelFFTDataGenerator.getSampleRate() > 0)
+        {
+            leftChannelFFTDataGenerator.pushSamples(tempIncomingBuffer.getReadPointer(0), tempIncomingBuffer.getNumSamples());
+            hasNewSamples = true;
+        }
+    }
 
-        auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-        auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
+    if (hasNewSamples)
+        leftChannelFFTDataGenerator.produceFFTDataForRendering(-48.f);
 
-        updateCutFilter(monoChain.get<ChainPositions::LowCut>(),
-            lowCutCoefficients,
-            chainSettings.lowCutSlope);
+    return hasNewSamples;
+}
 
-        updateCutFilter(monoChain.get<ChainPositions::HighCut>(),
-            highCutCoefficients,
-            chainSettings.highCutSlope);
+bool ResponseCurveComponent::generateAnalyzerPath()
+{
+    auto bounds = getLocalBounds();
+    const auto fftBounds = bounds.removeFromTop(bounds.getHeight()*0.85).toFloat();
 
+    if (leftChannelFFTDataGenerator.pullLatestFFTData())
+    {
+        const auto& binFrequencies = leftChannelFFTDataGenerator.getBinFrequencies();
+        pathProducer.generatePath(leftChannelFFTDataGenerator.getFFTData(), binFrequencies, fftBounds, -48.f);
 
-        //repaint();
+        if (onFFTFrame)
+            onFFTFrame(leftChannelFFTDataGenerator.getFFTData(), binFrequencies);
     }
-    repaint();
+
+    return pathProducer.pullLatestPath();
 }
 
-void ResponseCurveComponent::paint(juce::Graphics& g)
+juce::Path ResponseCurveComponent::createResponseCurvePath(bool side) const
 {
     using namespace juce;
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
-    //g.fillAll(Colours::black);
 
-    //g.setColour (juce::Colours::white);
-    //g.setFont (15.0f);
-    //g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
     auto bounds = getLocalBounds();
     //auto topArean = bounds.removeFromTop(bounds.getHeight() * 0.25);
     auto topArean = bounds;
 
     auto w = topArean.getWidth();
 
-    auto& lowcut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highcut = monoChain.get<ChainPositions::HighCut>();
-
-    auto sampleRate = audioProcessor.getSampleRate();
+    //in mid/side mode main is the mid curve, the one set by the main parameters
+    const auto& snapshot = getDrawnSnapshot();
+    const auto& cascade = side ? snapshot.side : snapshot.main;
 
     std::vector<double> mags;
 
@@ -132,29 +155,8 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 
     for (int i = 0; i < w; ++i)
     {
-        double mag = 1.0f;
         auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-
-        if (!monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-        if (!lowcut.isBypassed<0>())
-            mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!lowcut.isBypassed<1>())
-            mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!lowcut.isBypassed<2>())
-            mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!lowcut.isBypassed<3>())
-            mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-        if (!highcut.isBypassed<0>())
-            mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!highcut.isBypassed<1>())
-            mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!highcut.isBypassed<2>())
-            mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        if (!highcut.isBypassed<3>())
-            mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+        auto mag = CoefficientSnapshot::getMagnitudeForFrequency(cascade, freq, snapshot.sampleRate);
 
         mags[i] = Decibels::gainToDecibels(mag);
     }
@@ -167,23 +169,278 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
         return jmap(input, -24.0, 24.0, outputMin, outputMax);
     };
 
-    responseCurve.startNewSubPath(topArean.getX(), map(mags.front()));
-
-    for (size_t i = 1; i < mags.size(); ++i)
+    if (!mags.empty())
     {
-        responseCurve.lineTo(topArean.getX() + i, map(mags[i]));
+        responseCurve.startNewSubPath(topArean.getX(), map(mags.front()));
+
+        for (size_t i = 1; i < mags.size(); ++i)
+        {
+            responseCurve.lineTo(topArean.getX() + i, map(mags[i]));
+        }
     }
 
-    g.setColour(Colours::blue);
-    g.strokePath(leftChannelFFTPath, PathStrokeType(1.0f));
+    return responseCurve;
+}
+
+juce::Image ResponseCurveComponent::createLayerImage(juce::Image::PixelFormat format, float scale) const
+{
+    return juce::Image(format,
+        juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+        juce::jmax(1, juce::roundToInt(getHeight() * scale)),
+        true);
+}
+
+void ResponseCurveComponent::renderResponseCurve(float scale)
+{
+    using namespace juce;
+
+    responseCurveImage = createLayerImage(Image::ARGB, scale);
+
+    Graphics g(responseCurveImage);
+    g.addTransform(AffineTransform::scale(scale));
+
+    auto topArean = getLocalBounds();
+    const auto& snapshot = getDrawnSnapshot();
+    const auto midSide = snapshot.stereoMode == Stereo_MidSide;
+
+    auto responseCurve = createResponseCurvePath();
+    auto sideCurve = midSide ? createResponseCurvePath(true) : Path();
 
     g.setColour(Colours::orange);
     g.drawRoundedRectangle(topArean.toFloat(), 4.0f, 1.0f);
 
+    //while the A/B slots play, the live settings are not what is heard
+    if (snapshot.slotsPlaying)
+    {
+        g.setColour(Colours::white.withAlpha(0.3f));
+        g.strokePath(responseCurve, PathStrokeType(1.0f));
+        g.strokePath(sideCurve, PathStrokeType(1.0f));
+
+        g.setColour(Colours::orange);
+        g.setFont(12.0f);
+        g.drawText("A/B playing", topArean.reduced(8, 4), Justification::topRight);
+        return;
+    }
+
+    if (midSide)
+    {
+        g.setColour(Colours::lightgreen);
+        g.strokePath(sideCurve, PathStrokeType(2.0f));
+
+        g.setFont(12.0f);
+        g.drawText("side", topArean.reduced(8, 4), Justification::topLeft);
+        g.setColour(Colours::white);
+        g.drawText("mid", topArean.reduced(8, 4).withTrimmedTop(14), Justification::topLeft);
+    }
+
     g.setColour(Colours::white);
     g.strokePath(responseCurve, PathStrokeType(2.0f));
 }
 
+void ResponseCurveComponent::paint(juce::Graphics& g)
+{
+    SIMPLEEQ_TRACE_SCOPE("paint");
+
+    using namespace juce;
+
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (scale != cachedScale)
+    {
+        cachedScale = scale;
+        responseCurveNeedsRedraw = true;
+    }
+
+    if (responseCurveNeedsRedraw)
+    {
+        renderResponseCurve(scale);
+        responseCurveNeedsRedraw = false;
+    }
+
+    const auto bounds = getLocalBounds().toFloat();
+
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
+
+    //the analyzer is the only path drawn from scratch every frame
+    g.setColour(Colours::blue);
+    g.strokePath(pathProducer.getPath(), PathStrokeType(1.0f));
+
+    g.drawImage(responseCurveImage, bounds);
+}
+
+//==============================================================================
+SpectrogramComponent::SpectrogramComponent()
+{
+    //black -> blue -> magenta -> orange -> yellow -> white
+    juce::ColourGradient gradient(juce::Colours::black, 0.f, 0.f, juce::Colours::white, 1.f, 0.f, false);
+    gradient.addColour(0.25, juce::Colours::darkblue);
+    gradient.addColour(0.5, juce::Colours::darkmagenta);
+    gradient.addColour(0.7, juce::Colours::orange);
+    gradient.addColour(0.9, juce::Colours::yellow);
+
+    for (int i = 0; i < lutSize; ++i)
+        colourLUT[(size_t)i].set(gradient.getColourAtPosition((double)i / (lutSize - 1)).getPixelARGB());
+
+    setOpaque(true);
+}
+
+void SpectrogramComponent::resized()
+{
+    //one column per frame, so the width is the length of the history
+    history = juce::Image(juce::Image::RGB, juce::jmax(1, getWidth()), juce::jmax(1, getHeight()), true);
+    writeColumn = 0;
+    rowBinsNumBins = 0;
+}
+
+void SpectrogramComponent::updateRowBins(const std::vector<float>& binFrequencies)
+{
+    const auto numRows = history.getHeight();
+    const auto numBins = (int)binFrequencies.size();
+
+    //each row starts at the last bin at or below its frequency
+    rowBins.resize((size_t)numRows + 1);
+    for (int row = 0; row <= numRows; ++row)
+    {
+        const auto freq = (float)juce::mapToLog10((double)row / numRows, 20.0, 20000.0);
+        const auto above = (int)(std::upper_bound(binFrequencies.begin(), binFrequencies.end(), freq) - binFrequencies.begin());
+        rowBins[(size_t)row] = juce::jlimit(0, numBins - 1, above - 1);
+    }
+
+    rowBinsNumBins = binFrequencies.size();
+    rowBinsTopFrequency = binFrequencies.back();
+}
+
+void SpectrogramComponent::pushFrame(const std::vector<float>& fftData, const std::vector<float>& binFrequencies)
+{
+    SIMPLEEQ_TRACE_SCOPE("spectrogramColumn");
+
+    if (!history.isValid() || binFrequencies.size() < 2)
+        return;
+
+    if (binFrequencies.size() != rowBinsNumBins || binFrequencies.back() != rowBinsTopFrequency)
+        updateRowBins(binFrequencies);
+
+    const auto numRows = history.getHeight();
+    const auto scale = (lutSize - 1) / (maxDecibels - minDecibels);
+
+    //only the newest column is touched
+    juce::Image::BitmapData column(history, writeColumn, 0, 1, numRows, juce::Image::BitmapData::writeOnly);
+
+    //some backends (CoreGraphics among them) keep RGB images as 4-byte pixels
+    const auto packedRGB = column.pixelFormat == juce::Image::RGB && column.pixelStride == 3;
+
+    for (int row = 0; row < numRows; ++row)
+    {
+        const auto firstBin = rowBins[(size_t)row];
+        const auto endBin = juce::jmax(firstBin + 1, rowBins[(size_t)row + 1]);
+
+        auto decibels = fftData[(size_t)firstBin];
+        for (int bin = firstBin + 1; bin < endBin; ++bin)
+            decibels = juce::jmax(decibels, fftData[(size_t)bin]);
+
+        const auto index = juce::jlimit(0, lutSize - 1, (int)((decibels - minDecibels) * scale));
+        auto* pixel = column.getPixelPointer(0, numRows - 1 - row);
+
+        if (packedRGB)
+            reinterpret_cast<juce::PixelRGB*>(pixel)->set(colourLUT[(size_t)index]);
+        else
+            *reinterpret_cast<juce::PixelARGB*>(pixel) = colourLUT[(size_t)index];
+    }
+
+    writeColumn = (writeColumn + 1) % history.getWidth();
+    repaint();
+}
+
+void SpectrogramComponent::paint(juce::Graphics& g)
+{
+    SIMPLEEQ_TRACE_SCOPE("spectrogramPaint");
+
+    if (!history.isValid())
+        return;
+
+    //oldest columns start at writeColumn: draw them first, then wrap around
+    const auto width = history.getWidth(), height = history.getHeight();
+    const auto olderWidth = width - writeColumn;
+
+    g.drawImage(history, 0, 0, olderWidth, height, writeColumn, 0, olderWidth, height);
+
+    if (writeColumn > 0)
+        g.drawImage(history, olderWidth, 0, writeColumn, height, 0, 0, writeColumn, height);
+}
+
+//==============================================================================
+LevelMeterComponent::LevelMeterComponent(LevelMeter& m, const juce::String& n)
+    : meter(m),
+    name(n)
+{
+    peakDecibels.fill(minDecibels);
+    rmsDecibels.fill(minDecibels);
+
+    setOpaque(true);
+    startTimerHz(30);
+}
+
+void LevelMeterComponent::timerCallback()
+{
+    //repaint only when something moved, so meters on silence cost nothing
+    auto changed = false;
+
+    for (int ch = 0; ch < LevelMeter::maxChannels; ++ch)
+    {
+        const auto peak = juce::Decibels::gainToDecibels(meter.getPeakAndReset(ch), minDecibels);
+        const auto newPeak = juce::jmax(peak, peakDecibels[(size_t)ch] - peakFallPerTick, minDecibels);
+        const auto newRMS = juce::Decibels::gainToDecibels(meter.getRMS(ch), minDecibels);
+
+        changed = changed || newPeak != peakDecibels[(size_t)ch] || newRMS != rmsDecibels[(size_t)ch];
+        peakDecibels[(size_t)ch] = newPeak;
+        rmsDecibels[(size_t)ch] = newRMS;
+    }
+
+    //the readout has one decimal, so smaller moves would not show
+    const auto newLoudness = meter.getShortTermLoudness();
+    if (std::abs(newLoudness - loudness) >= 0.05f)
+    {
+        loudness = newLoudness;
+        changed = true;
+    }
+
+    if (changed)
+        repaint();
+}
+
+void LevelMeterComponent::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
+
+    auto bounds = getLocalBounds().reduced(2);
+    g.setColour(Colours::white);
+    g.setFont(10.f);
+    g.drawFittedText(name, bounds.removeFromTop(12), Justification::centred, 1);
+    g.drawFittedText(loudness > LevelMeter::minusInfinityLUFS ? String(loudness, 1) : String("-inf"),
+        bounds.removeFromBottom(12), Justification::centred, 1);
+
+    const auto barWidth = bounds.getWidth() / LevelMeter::maxChannels;
+    auto map = [&bounds](float db)
+    {
+        return jmap(jlimit(minDecibels, 0.f, db), minDecibels, 0.f, (float)bounds.getBottom(), (float)bounds.getY());
+    };
+
+    for (int ch = 0; ch < LevelMeter::maxChannels; ++ch)
+    {
+        const auto bar = bounds.withX(bounds.getX() + ch * barWidth).withWidth(barWidth).reduced(1, 0).toFloat();
+
+        g.setColour(Colours::darkgrey);
+        g.fillRect(bar);
+
+        g.setColour(Colours::green);
+        g.fillRect(bar.withTop(map(rmsDecibels[(size_t)ch])));
+
+        g.setColour(peakDecibels[(size_t)ch] > -0.1f ? Colours::red : Colours::orange);
+        g.fillRect(bar.withTop(map(peakDecibels[(size_t)ch])).withHeight(2.f));
+    }
+}
 
 //==============================================================================
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcessor& p)
@@ -196,7 +453,9 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcess
     //lowCutSlopeAttachment(audioProcessor.apvts, "LowCut Slope", lowCutSlopeComboBox),
     //highCutSlopAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeComboBox),
     GenericAudioProcessorEditor(audioProcessor),
-    responesCurve(audioProcessor)
+    responesCurve(audioProcessor),
+    inputMeter(audioProcessor.inputMeter, "In"),
+    outputMeter(audioProcessor.outputMeter, "Out")
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -206,18 +465,43 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcess
 
     addAndMakeVisible(GenericAudioProcessorEditor);
     addAndMakeVisible(responesCurve);
+
+    responesCurve.onFFTFrame = [this](const std::vector<float>& fftData, const std::vector<float>& binFrequencies)
+    {
+        spectrogram.pushFrame(fftData, binFrequencies);
+    };
+    addAndMakeVisible(spectrogram);
+    addAndMakeVisible(inputMeter);
+    addAndMakeVisible(outputMeter);
+    audioProcessor.addMeterConsumer();
+
+    storeAButton.onClick = [this] { audioProcessor.storeSlot(0); };
+    storeBButton.onClick = [this] { audioProcessor.storeSlot(1); };
+    addAndMakeVisible(storeAButton);
+    addAndMakeVisible(storeBButton);
+
+   #if SIMPLEEQ_ENABLE_TRACE
+    saveTraceButton.onClick = []
+    {
+        auto file = juce::File::getSpecialLocation(juce::File::userDesktopDirectory)
+            .getNonexistentChildFile("SimpleEQ-trace-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"), ".json");
+        Trace::writeToFile(file);
+    };
+    addAndMakeVisible(saveTraceButton);
+   #endif
     //for (auto* comp : getComps())
     //{
     //    addAndMakeVisible(comp);
     //}
 
     
-    setSize (400, 400);
+    //the slot buttons get a strip of their own under the generic editor
+    setSize (400, 520);
 }
 
 SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
 {
-
+    audioProcessor.removeMeterConsumer();
 }
 
 //==============================================================================
@@ -259,8 +543,21 @@ void SimpleEQAudioProcessorEditor::resized()
     //highCutSlopeComboBox.setBounds(SliderArean);
     //GenericAudioProcessorEditor.setBounds(bounds);
     //GenericAudioProcessorEditor.setCentreRelative(0.5f, 0.625f);
+    auto spectrogramArean = bounds.removeFromTop(80);
+    auto buttonArean = bounds.removeFromBottom(24);
+    outputMeter.setBounds(topArean.removeFromRight(32));
+    inputMeter.setBounds(topArean.removeFromRight(32));
     responesCurve.setBounds(topArean);
-    GenericAudioProcessorEditor.setBounds(bounds.getWidth()*0.05, topArean.getHeight(), bounds.getWidth(), bounds.getHeight());
+    spectrogram.setBounds(spectrogramArean);
+    GenericAudioProcessorEditor.setBounds(bounds.getWidth()*0.05, spectrogramArean.getBottom(), bounds.getWidth(), bounds.getHeight());
+
+   #if SIMPLEEQ_ENABLE_TRACE
+    saveTraceButton.setBounds(buttonArean.removeFromRight(100).reduced(2));
+   #endif
+
+    auto slotArean = buttonArean.removeFromLeft(160);
+    storeAButton.setBounds(slotArean.removeFromLeft(80).reduced(2));
+    storeBButton.setBounds(slotArean.reduced(2));
 }
 
 
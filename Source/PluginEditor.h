@@ -10,207 +10,141 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
-
-enum FFTOrder
-{
-    order2048 = 11,
-    order4096 = 12,
-    order8192 = 13
-};
-
-template<typename BlockType>
-struct FFTDataGenerator
-{
-    /**
-     produces the FFT data from an audio buffer.
-     */
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
-    {
-        const auto fftSize = getFFTSize();
-
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
-
-        // first apply a windowing function to our data
-        window->multiplyWithWindowingTable(fftData.data(), fftSize);       // [1]
-
-        // then render our FFT data..
-        forwardFFT->performFrequencyOnlyForwardTransform(fftData.data());  // [2]
-
-        int numBins = (int)fftSize / 2;
-
-        //normalize the fft values.
-        for (int i = 0; i < numBins; ++i)
-        {
-            auto v = fftData[i];
-            //            fftData[i] /= (float) numBins;
-            if (!std::isinf(v) && !std::isnan(v))
-            {
-                v /= float(numBins);
-            }
-            else
-            {
-                v = 0.f;
-            }
-            fftData[i] = v;
-        }
-
-        //convert them to decibels
-        for (int i = 0; i < numBins; ++i)
-        {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
-
-        fftDataFifo.push(fftData);
-    }
-
-    void changeOrder(FFTOrder newOrder)
-    {
-        //when you change order, recreate the window, forwardFFT, fifo, fftData
-        //also reset the fifoIndex
-        //things that need recreating should be created on the heap via std::make_unique<>
-
-        order = newOrder;
-        auto fftSize = getFFTSize();
-
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
-
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
-
-        fftDataFifo.prepare(fftData.size());
-    }
-    //==============================================================================
-    int getFFTSize() const { return 1 << order; }
-    int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
-    //==============================================================================
-    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
-private:
-    FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
-
-    Fifo<BlockType> fftDataFifo;
-};
+#include "Analyzer.h"
+#include "Trace.h"
 
 //==============================================================================
 /**
 */
-template<typename PathType>
-struct AnalyzerPathGenerator
+struct ResponseCurveComponent : juce::Component,
+    juce::Timer,
+    juce::AudioProcessorParameter::Listener
 {
-    /*
-     converts 'renderData[]' into a juce::Path
-     */
-    void generatePath(const std::vector<float>& renderData,
-        juce::Rectangle<float> fftBounds,
-        int fftSize,
-        float binWidth,
-        float negativeInfinity)
-    {
-        auto top = fftBounds.getY();
-        auto bottom = fftBounds.getHeight();
-        auto width = fftBounds.getWidth();
+    ResponseCurveComponent(SimpleEQAudioProcessor&);
+    ~ResponseCurveComponent();
 
-        int numBins = (int)fftSize / 2;
+    void timerCallback() override;
 
-        PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override { }
 
-        auto map = [bottom, top, negativeInfinity](float v)
-        {
-            return juce::jmap(v,
-                negativeInfinity, 0.f,
-                float(bottom + 10), top);
-        };
+    void paint(juce::Graphics& g) override;
+    void resized() override;
 
-        auto y = map(renderData[0]);
+    /** called with every new analyzer frame (dB per bin, and each bin's frequency), e.g. to feed a SpectrogramComponent. */
+    std::function<void(const std::vector<float>& fftData, const std::vector<float>& binFrequencies)> onFFTFrame;
 
-        //        jassert( !std::isnan(y) && !std::isinf(y) );
-        if (std::isnan(y) || std::isinf(y))
-            y = bottom;
+    /*
+     the stages of timerCallback() and paint(), public so they can be timed one by one
+     */
+    /** drains the analyzer FIFO and transforms the newest window; returns false if there were no new samples. */
+    bool produceAnalyzerFrame();
+    /** turns the newest frame into the analyzer path (and calls onFFTFrame); returns false if there was none. */
+    bool generateAnalyzerPath();
+    /** evaluates the drawn snapshot's main cascade (or, in mid/side mode, its side one) across the width. */
+    juce::Path createResponseCurvePath(bool side = false) const;
 
-        p.startNewSubPath(0, y);
+    const juce::Path& getAnalyzerPath() const { return pathProducer.getPath(); }
 
-        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
+private:
+    SimpleEQAudioProcessor& audioProcessor;
 
-        for (int binNum = 1; binNum < numBins; binNum += pathResolution)
-        {
-            y = map(renderData[binNum]);
+    //the timer drops to idleRefreshRateHz after this many ticks without new analyzer data
+    static constexpr int activeRefreshRateHz = 60;
+    static constexpr int idleRefreshRateHz = 10;
+    static constexpr int idleTicksBeforeBackoff = 30;
+    int idleTicks = 0;
 
-            //            jassert( !std::isnan(y) && !std::isinf(y) );
+    //the response curve layer, only rebuilt on resize, scale change or parameter change;
+    //the background is a plain fill, cheaper to repeat than to blit
+    juce::Image responseCurveImage;
+    float cachedScale = 0.f;
+    bool responseCurveNeedsRedraw = true;
 
-            if (!std::isnan(y) && !std::isinf(y))
-            {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
-            }
-        }
+    void renderResponseCurve(float scale);
+    juce::Image createLayerImage(juce::Image::PixelFormat format, float scale) const;
 
-        pathFifo.push(p);
-    }
+    //the curve is drawn from the processor's published coefficients
+    juce::uint32 drawnSnapshotVersion = 0;
 
-    int getNumPathsAvailable() const
-    {
-        return pathFifo.getNumAvailableForReading();
-    }
+    //the audio thread only publishes from processBlock(), which a stopped host may not call, so a
+    //parameter change is designed here and drawn until a snapshot published after it arrives
+    std::atomic<bool> parametersChanged{ false };
+    CoefficientSnapshot parameterSnapshot;
+    bool drawParameterSnapshot = false;
+    juce::uint32 snapshotVersionAtParameterChange = 0;
 
-    bool getPath(PathType& path)
+    const CoefficientSnapshot& getDrawnSnapshot() const
     {
-        return pathFifo.pull(path);
+        return drawParameterSnapshot ? parameterSnapshot : audioProcessor.getCoefficientSnapshot();
     }
-private:
-    Fifo<PathType> pathFifo;
-};
 
+    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
 
+    //a decimated low band gives the bottom octaves finer bins than one 4096-point frame
+    MultiResolutionFFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
 
+    AnalyzerPathGenerator<juce::Path> pathProducer;
+};
 
 //==============================================================================
 /**
-*/
-struct ResponseCurveComponent : juce::Component,
-    juce::AudioProcessorParameter::Listener,
-    juce::Timer
+ A scrolling spectrogram. Every FFT frame becomes one new column of a circular
+ image, written through a precomputed colour table; paint() blits the image in
+ two parts around the write position, so the history is never redrawn.
+ */
+struct SpectrogramComponent : juce::Component
 {
-    ResponseCurveComponent(SimpleEQAudioProcessor&);
-    ~ResponseCurveComponent();
+    SpectrogramComponent();
 
-    void parameterValueChanged(int parameterIndex, float newValue) override;
-
-    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override { }
-
-    void timerCallback() override;
+    void pushFrame(const std::vector<float>& fftData, const std::vector<float>& binFrequencies);
 
     void paint(juce::Graphics& g) override;
-
+    void resized() override;
 
 private:
-    SimpleEQAudioProcessor& audioProcessor;
+    static constexpr float minDecibels = -48.f, maxDecibels = 0.f;
+    static constexpr int lutSize = 256;
 
+    std::array<juce::PixelARGB, lutSize> colourLUT;   // opaque
 
-    juce::Atomic<bool> parametersChanged{ false };
+    juce::Image history;
+    int writeColumn = 0;
 
-    MonoChain monoChain;
+    //rows, bottom up, each show the loudest bin in [rowBins[row], rowBins[row + 1])
+    std::vector<int> rowBins;
+    size_t rowBinsNumBins = 0;
+    float rowBinsTopFrequency = 0;
 
-    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
+    void updateRowBins(const std::vector<float>& binFrequencies);
+};
 
-    juce::AudioBuffer<float> monoBuffer;
 
-    FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
 
-    AnalyzerPathGenerator<juce::Path> pathProducer;
 
-    juce::Path leftChannelFFTPath;
-};
+//==============================================================================
+/**
+ Peak and RMS bars per channel and the short-term loudness of one LevelMeter.
+ Only reads the meter's atomics; the peak marker falls back slowly here.
+ */
+struct LevelMeterComponent : juce::Component,
+    juce::Timer
+{
+    LevelMeterComponent(LevelMeter& meter, const juce::String& name);
 
+    void timerCallback() override;
+    void paint(juce::Graphics& g) override;
+
+private:
+    static constexpr float minDecibels = -60.f;
+    static constexpr float peakFallPerTick = 0.75f;   // dB per 30 Hz tick
 
+    LevelMeter& meter;
+    juce::String name;
 
+    std::array<float, LevelMeter::maxChannels> peakDecibels, rmsDecibels;
+    float loudness = LevelMeter::minusInfinityLUFS;
+};
 
 //==============================================================================
 /**
@@ -266,6 +200,17 @@ private:
 
     ResponseCurveComponent responesCurve;
 
+    SpectrogramComponent spectrogram;
+
+    LevelMeterComponent inputMeter, outputMeter;
+
+    //keep the current settings in the A/B slots, which the "A/B" and "A/B Morph" parameters then play
+    juce::TextButton storeAButton{ "Store A" }, storeBButton{ "Store B" };
+
+   #if SIMPLEEQ_ENABLE_TRACE
+    juce::TextButton saveTraceButton{ "Save trace" };
+   #endif
+
 
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessorEditor)
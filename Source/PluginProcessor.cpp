@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "Trace.h"
 
 //==============================================================================
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
@@ -16,12 +17,15 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    //the analyzer's buffers never change size, so they are allocated once, before any reader can attach
+    leftChannelFifo.prepare(analyzerBufferSize);
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
@@ -95,17 +99,93 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    juce::ignoreUnused(samplesPerBlock);
+
+    for (size_t i = 0; i < oversamplers.size(); ++i)
+    {
+        if (oversamplers[i] == nullptr)
+            oversamplers[i] = std::make_unique<juce::dsp::Oversampling<float>>(2, i + 1,
+                juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+
+        oversamplers[i]->initProcessing(subBlockSize);
+    }
+
     juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
+    spec.maximumBlockSize = subBlockSize << maxOversamplingOrder;
     spec.numChannels = 1;
     spec.sampleRate = sampleRate;
     leftChain.prepare(spec);
     rightChain.prepare(spec);
-    
+    dynamicPeak.prepare(sampleRate, subBlockSize);
+
+    spec.maximumBlockSize = subBlockSize;
+
+    for (auto& slot : slotFilters)
+    {
+        slot.left.prepare(spec);
+        slot.right.prepare(spec);
+        slot.midSide.reset();
+    }
+
+    //every chain a design is made in or copied into gets biquad-sized coefficients now, so
+    //neither designing on the audio thread nor adopting a design there ever allocates
+    prepareBiquadCoefficients(leftChain);
+    prepareBiquadCoefficients(rightChain);
+    prepareBiquadCoefficients(audioThreadDesign.main);
+    prepareBiquadCoefficients(audioThreadDesign.side);
+
+    for (auto& slot : slotFilters)
+    {
+        prepareBiquadCoefficients(slot.left);
+        prepareBiquadCoefficients(slot.right);
+    }
+
+    {
+        const juce::ScopedLock sl(designWriterLock);
+
+        pendingDesigns.forEachBuffer([](ChainDesign& design)
+        {
+            prepareBiquadCoefficients(design.main);
+            prepareBiquadCoefficients(design.side);
+        });
+
+        //a design still waiting was just emptied; updateFilters() below designs from the same parameters
+        pendingDesigns.pull();
+
+        //the stored slots are designed again below
+        for (auto& slotDesign : slotDesigns)
+            slotDesign.forEachBuffer([](SlotDesign& design)
+            {
+                prepareBiquadCoefficients(design.main);
+                prepareBiquadCoefficients(design.side);
+            });
+    }
+
+    morphBuffer.setSize(2, subBlockSize);
+    crossfadeBuffer.setSize(2, subBlockSize);
+    morph.reset(sampleRate, 0.02);
+    slotsMix.reset(sampleRate, 0.02);
+    slotsMix.setCurrentAndTargetValue(slotsActive ? 1.f : 0.f);
+
+    //the slots are designed for a sample rate too
+    {
+        const juce::ScopedLock sl(designWriterLock);
+
+        for (int slot = 0; slot < numSlots; ++slot)
+            designSlot(slot);
+    }
+
+    //prepare() may have touched the chains and the bell, so always install a design, even at the same rate
+    designedSampleRate = 0.0;
     updateFilters();
+    updateLatency();
+    samplesUntilNextUpdate = subBlockSize;
+
+    //an open editor may be draining the FIFOs right now, so only drop the writer's partial buffer
+    leftChannelFifo.restart();
 
-    leftChannelFifo.prepare(samplesPerBlock);
-    rightChannelFifo.prepare(samplesPerBlock);
+    inputMeter.prepare(sampleRate);
+    outputMeter.prepare(sampleRate);
 }
 
 void SimpleEQAudioProcessor::releaseResources()
@@ -133,6 +213,16 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain may be off, mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        const auto sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -142,6 +232,8 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    SIMPLEEQ_TRACE_SCOPE("processBlock");
+
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -155,21 +247,168 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    //nobody sees the meters while no editor is open, so they cost nothing then
+    const auto meteringActive = numMeterConsumers.load(std::memory_order_acquire) > 0;
+    if (meteringActive)
+    {
+        SIMPLEEQ_TRACE_SCOPE("metering");
+
+        //the RMS and loudness windows would otherwise still hold audio from before the meters were shown
+        if (!meteringWasActive)
+        {
+            inputMeter.reset();
+            outputMeter.reset();
+        }
+
+        inputMeter.process(buffer);
+    }
+    meteringWasActive = meteringActive;
 
-    
     juce::dsp::AudioBlock<float> block(buffer);
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    const auto numSamples = (int)block.getNumSamples();
+
+    auto sidechain = getBusCount(true) > 1 ? getBusBuffer(buffer, true, 1) : juce::AudioBuffer<float>();
+
+    for (int start = 0; start < numSamples;)
+    {
+        if (samplesUntilNextUpdate == 0)
+        {
+            installPendingDesign();
+            updateFilters();
+            updateSlots();
+            updateLatency();
+            samplesUntilNextUpdate = subBlockSize;
+        }
+
+        const auto numToProcess = juce::jmin(numSamples - start, samplesUntilNextUpdate);
+        auto subBlock = block.getSubBlock((size_t)start, (size_t)numToProcess);
+
+        //while "A/B" changes both paths run, from their own states, and slotsMix crossfades them
+        if (!slotsMix.isSmoothing())
+        {
+            if (slotsActive)
+                processSlots(subBlock);
+            else
+                processChains(subBlock, sidechain, start);
+        }
+        else
+        {
+            auto slotBlock = juce::dsp::AudioBlock<float>(crossfadeBuffer).getSubBlock(0, (size_t)numToProcess);
+            slotBlock.copyFrom(subBlock.getSubsetChannelBlock(0, 2));
+
+            processSlots(slotBlock);
+            processChains(subBlock, sidechain, start);
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto* live = subBlock.getChannelPointer((size_t)ch);
+                const auto* slots = slotBlock.getChannelPointer((size_t)ch);
+                auto mix = slotsMix;
+
+                for (int i = 0; i < numToProcess; ++i)
+                    live[i] += mix.getNextValue() * (slots[i] - live[i]);
+            }
+
+            slotsMix.skip(numToProcess);
+        }
+
+        samplesUntilNextUpdate -= numToProcess;
+        start += numToProcess;
+    }
+
+    if (meteringActive)
+    {
+        SIMPLEEQ_TRACE_SCOPE("metering");
+        outputMeter.process(buffer);
+    }
+
+    if (numAnalyzerConsumers.load(std::memory_order_acquire) > 0)
+    {
+        SIMPLEEQ_TRACE_SCOPE("analyzerFifoPush");
+
+        //start from an empty buffer so a new consumer never sees samples from before it attached,
+        //even one that closed and reopened between two blocks, where the count never read 0
+        const auto generation = analyzerGeneration.load(std::memory_order_acquire);
+        if (generation != pushedAnalyzerGeneration)
+        {
+            leftChannelFifo.restart();
+            pushedAnalyzerGeneration = generation;
+        }
+
+        leftChannelFifo.update(buffer);
+    }
+}
+
+void SimpleEQAudioProcessor::processChains(juce::dsp::AudioBlock<float>& subBlock, const juce::AudioBuffer<float>& sidechain, int start)
+{
+    const auto numSamples = (int)subBlock.getNumSamples();
+
+    auto* oversampler = getActiveOversampler();
+    auto stereoBlock = subBlock.getSubsetChannelBlock(0, 2);
+    auto processingBlock = oversampler != nullptr ? oversampler->processSamplesUp(stereoBlock) : stereoBlock;
+
+    if (stereoMode == Stereo_MidSide)
+    {
+        midSideKernel.process(processingBlock.getChannelPointer(0), processingBlock.getChannelPointer(1), (int)processingBlock.getNumSamples());
+    }
+    else
+    {
+        auto leftBlock = processingBlock.getSingleChannelBlock(0);
+        auto rightBlock = processingBlock.getSingleChannelBlock(1);
+
+        juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+        juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+
+        leftChain.process(leftContext);
+        rightChain.process(rightContext);
+    }
+
+    if (oversampler != nullptr)
+        oversampler->processSamplesDown(stereoBlock);
+
+    //the dynamic bell runs at the host rate, after the chains
+    if (dynamicPeakActive)
+    {
+        float* channels[] = { subBlock.getChannelPointer(0), subBlock.getChannelPointer(1) };
+        const float* detector[DynamicPeakFilter::maxChannels] = { channels[0], channels[1] };
+        auto numDetectorChannels = 2;
+
+        if (designedDynamicSettings.source == Source_Sidechain && sidechain.getNumChannels() > 0)
+        {
+            numDetectorChannels = juce::jmin(sidechain.getNumChannels(), (int)DynamicPeakFilter::maxChannels);
+            for (int ch = 0; ch < numDetectorChannels; ++ch)
+                detector[ch] = sidechain.getReadPointer(ch, start);
+        }
+
+        dynamicPeak.process(channels, 2, detector, numDetectorChannels, numSamples);
+    }
+}
+
+void SimpleEQAudioProcessor::addAnalyzerConsumer()
+{
+    //nothing is pushed while there are no consumers, so anything still queued is stale
+    if (numAnalyzerConsumers.load() == 0)
+        leftChannelFifo.discardAvailableBuffers();
+
+    analyzerGeneration.fetch_add(1, std::memory_order_release);
+    numAnalyzerConsumers.fetch_add(1, std::memory_order_release);
+}
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+void SimpleEQAudioProcessor::removeAnalyzerConsumer()
+{
+    jassert(numAnalyzerConsumers.load() > 0);
+    numAnalyzerConsumers.fetch_sub(1, std::memory_order_release);
+}
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+void SimpleEQAudioProcessor::addMeterConsumer()
+{
+    numMeterConsumers.fetch_add(1, std::memory_order_release);
+}
 
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+void SimpleEQAudioProcessor::removeMeterConsumer()
+{
+    jassert(numMeterConsumers.load() > 0);
+    numMeterConsumers.fetch_sub(1, std::memory_order_release);
 }
 
 //==============================================================================
@@ -190,92 +429,670 @@ void SimpleEQAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    CompactStateFormat::State state;
+    {
+        const juce::ScopedLock sl(designWriterLock);
+        state = storedSlots;
+    }
+
+    state.live = stateFormat.capture();
+    stateFormat.write(state, destData);
 }
 
 void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    if (CompactStateFormat::isCompactState(data, sizeInBytes))
+    {
+        CompactStateFormat::State state;
+        if (!stateFormat.read(data, sizeInBytes, state))
+            return;
+
+        stateFormat.apply(state.live);
+
+        const juce::ScopedLock sl(designWriterLock);
+
+        //a slot missing from the state empties the one the last session may have left
+        storedSlots = state;
+        for (int slot = 0; slot < numSlots; ++slot)
+            designSlot(slot);
+
+        publishDesign();
+        return;
+    }
+
+    //sessions saved before the compact format hold the ValueTree
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if (tree.isValid())
     {
         apvts.replaceState(tree);
-        updateFilters();
+
+        const juce::ScopedLock sl(designWriterLock);
+
+        //that format had no slots, so none of the last session's may survive
+        storedSlots = {};
+        for (int slot = 0; slot < numSlots; ++slot)
+            designSlot(slot);
+
+        publishDesign();
+    }
+}
+
+void SimpleEQAudioProcessor::storeSlot(int slot)
+{
+    jassert(slot >= 0 && slot < numSlots);
+
+    const juce::ScopedLock sl(designWriterLock);
+
+    storedSlots.slots[(size_t)slot] = stateFormat.capture();
+    storedSlots.hasSlot[(size_t)slot] = true;
+    designSlot(slot);
+}
+
+void SimpleEQAudioProcessor::designSlot(int slot)
+{
+    //the TripleBuffer takes a single producer, and storeSlot(), setStateInformation() and
+    //prepareToPlay() may all be on different threads
+    const juce::ScopedLock sl(designWriterLock);
+
+    if (!storedSlots.hasSlot[(size_t)slot])
+    {
+        auto& design = slotDesigns[(size_t)slot].getWriteBuffer();
+        design.stored = false;
+        slotDesigns[(size_t)slot].finishedWrite();
+        return;
+    }
+
+    //without a sample rate there is nothing to design for yet; prepareToPlay() comes back here
+    if (getSampleRate() <= 0)
+        return;
+
+    const auto& values = storedSlots.slots[(size_t)slot];
+    auto getValue = [this, &values](const char* parameterID) { return stateFormat.getValue(values, parameterID); };
+
+    auto& design = slotDesigns[(size_t)slot].getWriteBuffer();
+    design.stereoMode = static_cast<StereoMode>(getValue("Stereo Mode"));
+    design.stored = true;
+
+    updateMonoChain(design.main, readChainSetting(getValue), getSampleRate(), *sharedResources);
+    if (design.stereoMode == Stereo_MidSide)
+        updateMonoChain(design.side, readSideChainSetting(getValue), getSampleRate(), *sharedResources);
+
+    slotDesigns[(size_t)slot].finishedWrite();
+}
+
+void SimpleEQAudioProcessor::updateSlots()
+{
+    //adopt new designs by copying their coefficients, so the filter states carry on
+    for (size_t slot = 0; slot < slotFilters.size(); ++slot)
+    {
+        if (!slotDesigns[slot].pull())
+            continue;
+
+        const auto& design = slotDesigns[slot].getReadBuffer();
+        auto& filters = slotFilters[slot];
+
+        if (!design.stored)
+        {
+            filters.designed = false;
+            continue;
+        }
+
+        if (design.stereoMode != filters.stereoMode)
+        {
+            filters.left.reset();
+            filters.right.reset();
+            filters.midSide.reset();
+        }
+
+        filters.stereoMode = design.stereoMode;
+        if (filters.stereoMode == Stereo_MidSide)
+        {
+            filters.midSide.setCoefficients(design.main, design.side);
+        }
+        else
+        {
+            copyCoefficients(filters.left, design.main);
+            copyCoefficients(filters.right, design.main);
+        }
+
+        filters.designed = true;
+    }
+
+    const auto active = apvts.getRawParameterValue("A/B")->load() > 0.5f
+        && slotFilters[0].designed && slotFilters[1].designed;
+
+    const auto morphTarget = apvts.getRawParameterValue("A/B Morph")->load();
+
+    //the path taking over has sat idle, so it starts from silence, but it fades in over slotsMix
+    //while the outgoing one keeps running from its own states
+    if (active != slotsActive)
+    {
+        //a switch back during the crossfade finds the incoming path still running
+        const auto incomingWasIdle = !slotsMix.isSmoothing();
+
+        if (active && incomingWasIdle)
+        {
+            for (auto& filters : slotFilters)
+            {
+                filters.left.reset();
+                filters.right.reset();
+                filters.midSide.reset();
+            }
+
+            morph.setCurrentAndTargetValue(morphTarget);
+        }
+        else if (incomingWasIdle)
+        {
+            leftChain.reset();
+            rightChain.reset();
+            midSideKernel.reset();
+            dynamicPeak.reset();
+
+            if (auto* oversampler = getActiveOversampler())
+                oversampler->reset();
+        }
+
+        slotsActive = active;
+        slotsMix.setTargetValue(active ? 1.f : 0.f);
+
+        //the curve tells whether it is what is heard
+        publishCoefficientSnapshot();
+    }
+
+    morph.setTargetValue(morphTarget);
+}
+
+void SimpleEQAudioProcessor::processSlots(juce::dsp::AudioBlock<float>& block)
+{
+    const auto numSamples = (int)block.getNumSamples();
+
+    //A filters the block in place, B a copy of it
+    auto other = juce::dsp::AudioBlock<float>(morphBuffer).getSubBlock(0, (size_t)numSamples);
+    other.copyFrom(block);
+
+    juce::dsp::AudioBlock<float>* outputs[] = { &block, &other };
+    for (size_t slot = 0; slot < slotFilters.size(); ++slot)
+    {
+        auto& filters = slotFilters[slot];
+        auto& output = *outputs[slot];
+
+        if (filters.stereoMode == Stereo_MidSide)
+        {
+            filters.midSide.process(output.getChannelPointer(0), output.getChannelPointer(1), numSamples);
+        }
+        else
+        {
+            auto leftBlock = output.getSingleChannelBlock(0);
+            auto rightBlock = output.getSingleChannelBlock(1);
+
+            juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+            juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+
+            filters.left.process(leftContext);
+            filters.right.process(rightContext);
+        }
+    }
+
+    //A + morph * (B - A)
+    other.subtract(block);
+
+    if (!morph.isSmoothing())
+    {
+        block.addProductOf(other, morph.getTargetValue());
+        return;
+    }
+
+    auto* left = block.getChannelPointer(0);
+    auto* right = block.getChannelPointer(1);
+    const auto* leftDifference = other.getChannelPointer(0);
+    const auto* rightDifference = other.getChannelPointer(1);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto amount = morph.getNextValue();
+        left[i] += amount * leftDifference[i];
+        right[i] += amount * rightDifference[i];
     }
 }
 
 ChainSettings getChainSetting(juce::AudioProcessorValueTreeState& apvts)
 {
-    ChainSettings settings;
+    return readChainSetting([&apvts](const char* parameterID) { return apvts.getRawParameterValue(parameterID)->load(); });
+}
+
+ChainSettings getSideChainSetting(juce::AudioProcessorValueTreeState& apvts)
+{
+    return readSideChainSetting([&apvts](const char* parameterID) { return apvts.getRawParameterValue(parameterID)->load(); });
+}
 
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HighCut Slope")->load());
+DynamicSettings getDynamicSetting(juce::AudioProcessorValueTreeState& apvts)
+{
+    DynamicSettings settings;
 
+    settings.mode = static_cast<PeakMode>(apvts.getRawParameterValue("Peak Mode")->load());
+    settings.source = static_cast<DynamicSource>(apvts.getRawParameterValue("Dynamic Source")->load());
+    settings.thresholdInDecibels = apvts.getRawParameterValue("Dynamic Threshold")->load();
+    settings.rangeInDecibels = apvts.getRawParameterValue("Dynamic Range")->load();
+    settings.attackMs = apvts.getRawParameterValue("Dynamic Attack")->load();
+    settings.releaseMs = apvts.getRawParameterValue("Dynamic Release")->load();
 
     return settings;
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
+void updateCoefficients(Coefficients& old, const Coefficients& replacement)
 {
-    /*auto peakCoefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(),
-        chainSettings.peakFreq,
-        chainSettings.peakQuality,
-        juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));*/
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    //same order: overwrite in place, so designing into a prepared chain never allocates.
+    //A chain that was never through prepareBiquadCoefficients() (the tools', the editor's) takes
+    //the copy, which does
+    auto& coefficients = old->coefficients;
+    const auto& source = replacement->coefficients;
+
+    if (coefficients.size() == source.size())
+        std::copy(source.begin(), source.end(), coefficients.begin());
+    else
+        *old = *replacement;
 }
 
-void updateCoefficients(Coefficients& old, Coefficients& replacement)
+namespace
 {
-    *old = *replacement;
+    void copyCoefficientsInPlace(Coefficients& destination, const Coefficients& source)
+    {
+        auto& coefficients = destination->coefficients;
+        const auto& values = source->coefficients;
+
+        //every chain the audio thread copies into is biquad-sized in prepareToPlay(), and every
+        //design is made of biquads, so a mismatch is a chain that was never prepared
+        if (coefficients.size() != values.size())
+        {
+            jassertfalse;
+            return;
+        }
+
+        std::copy(values.begin(), values.end(), coefficients.begin());
+    }
+}
+
+void copyCoefficients(MonoChain& chain, const MonoChain& source)
+{
+    auto copyCut = [](CutFilter& cut, const CutFilter& sourceCut)
+    {
+        copyCoefficientsInPlace(cut.get<0>().coefficients, sourceCut.get<0>().coefficients);
+        copyCoefficientsInPlace(cut.get<1>().coefficients, sourceCut.get<1>().coefficients);
+        copyCoefficientsInPlace(cut.get<2>().coefficients, sourceCut.get<2>().coefficients);
+        copyCoefficientsInPlace(cut.get<3>().coefficients, sourceCut.get<3>().coefficients);
+
+        cut.setBypassed<0>(sourceCut.isBypassed<0>());
+        cut.setBypassed<1>(sourceCut.isBypassed<1>());
+        cut.setBypassed<2>(sourceCut.isBypassed<2>());
+        cut.setBypassed<3>(sourceCut.isBypassed<3>());
+    };
+
+    copyCut(chain.get<ChainPositions::LowCut>(), source.get<ChainPositions::LowCut>());
+    copyCut(chain.get<ChainPositions::HighCut>(), source.get<ChainPositions::HighCut>());
+
+    copyCoefficientsInPlace(chain.get<ChainPositions::Peak>().coefficients, source.get<ChainPositions::Peak>().coefficients);
+    chain.setBypassed<ChainPositions::Peak>(source.isBypassed<ChainPositions::Peak>());
+}
+
+void prepareBiquadCoefficients(MonoChain& chain)
+{
+    //a pass-through biquad
+    auto prepare = [](Filter& filter) { filter.coefficients = new juce::dsp::IIR::Coefficients<float>(1.f, 0.f, 0.f, 1.f, 0.f, 0.f); };
+
+    auto prepareCut = [&prepare](CutFilter& cut)
+    {
+        prepare(cut.get<0>());
+        prepare(cut.get<1>());
+        prepare(cut.get<2>());
+        prepare(cut.get<3>());
+    };
+
+    prepareCut(chain.get<ChainPositions::LowCut>());
+    prepareCut(chain.get<ChainPositions::HighCut>());
+    prepare(chain.get<ChainPositions::Peak>());
 }
 
 Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
 {
+    if (chainSettings.designMode == Design_Matched)
+        return MatchedFilterDesign::makePeakFilter(sampleRate,
+            chainSettings.peakFreq,
+            chainSettings.peakQuality,
+            juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+
     return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate,
         chainSettings.peakFreq,
         chainSettings.peakQuality,
         juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
 }
 
+namespace
+{
+    enum DesignType
+    {
+        PeakDesign,
+        LowCutDesign,
+        HighCutDesign
+    };
 
+    template<typename Designs>
+    CutCoefficients toCutCoefficients(const Designs& designs)
+    {
+        CutCoefficients coefficients;
+        for (int i = 0; i < juce::jmin(designs.size(), (int)coefficients.size()); ++i)
+            coefficients[(size_t)i] = designs[i];
 
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
+        return coefficients;
+    }
+}
+
+Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources)
 {
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
+    SharedDSPResources::DesignKey key;
+    key.type = PeakDesign;
+    key.mode = chainSettings.designMode;
+    key.frequency = chainSettings.peakFreq;
+    key.quality = chainSettings.peakQuality;
+    key.gainInDecibels = chainSettings.peakGainInDecibels;
+    key.sampleRate = sampleRate;
 
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    return sharedResources.getDesign(key, [&]
+        {
+            return CutCoefficients{ makePeakFilter(chainSettings, sampleRate) };
+        })[0];
+}
 
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
+CutCoefficients makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources)
+{
+    SharedDSPResources::DesignKey key;
+    key.type = LowCutDesign;
+    key.mode = chainSettings.designMode;
+    key.frequency = chainSettings.lowCutFreq;
+    key.order = 2 * (chainSettings.lowCutSlope + 1);
+    key.sampleRate = sampleRate;
+
+    return sharedResources.getDesign(key, [&]
+        {
+            return toCutCoefficients(makeLowCutFilter(chainSettings, sampleRate));
+        });
+}
+
+CutCoefficients makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources)
+{
+    SharedDSPResources::DesignKey key;
+    key.type = HighCutDesign;
+    key.mode = chainSettings.designMode;
+    key.frequency = chainSettings.highCutFreq;
+    key.order = 2 * (chainSettings.highCutSlope + 1);
+    key.sampleRate = sampleRate;
+
+    return sharedResources.getDesign(key, [&]
+        {
+            return toCutCoefficients(makeHighCutFilter(chainSettings, sampleRate));
+        });
+}
+
+
+
+void updateMonoChain(MonoChain& chain, const ChainSettings& chainSettings, double sampleRate)
+{
+    auto peakCoefficients = makePeakFilter(chainSettings, sampleRate);
+    updateCoefficients(chain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+
+    updateCutFilter(chain.get<ChainPositions::LowCut>(),
+        makeLowCutFilter(chainSettings, sampleRate),
+        chainSettings.lowCutSlope);
+
+    updateCutFilter(chain.get<ChainPositions::HighCut>(),
+        makeHighCutFilter(chainSettings, sampleRate),
+        chainSettings.highCutSlope);
+}
+
+void updateMonoChain(MonoChain& chain, const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources)
+{
+    auto peakCoefficients = makePeakFilter(chainSettings, sampleRate, sharedResources);
+    updateCoefficients(chain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+
+    updateCutFilter(chain.get<ChainPositions::LowCut>(),
+        makeLowCutFilter(chainSettings, sampleRate, sharedResources),
+        chainSettings.lowCutSlope);
+
+    updateCutFilter(chain.get<ChainPositions::HighCut>(),
+        makeHighCutFilter(chainSettings, sampleRate, sharedResources),
+        chainSettings.highCutSlope);
+}
+
+void SimpleEQAudioProcessor::readDesignSettings(ChainDesign& design)
+{
+    design.settings = getChainSetting(apvts);
+    design.sideSettings = getSideChainSetting(apvts);
+    design.stereoMode = static_cast<StereoMode>(apvts.getRawParameterValue("Stereo Mode")->load());
+    design.dynamicSettings = getDynamicSetting(apvts);
+    design.oversamplingOrder = juce::jlimit(0, maxOversamplingOrder, (int)apvts.getRawParameterValue("Oversampling")->load());
+    design.hostSampleRate = getSampleRate();
 }
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::designChains(ChainDesign& design)
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
+    const auto processingSampleRate = design.getProcessingSampleRate();
+
+    updateMonoChain(design.main, design.settings, processingSampleRate, *sharedResources);
+    if (design.stereoMode == Stereo_MidSide)
+        updateMonoChain(design.side, design.sideSettings, processingSampleRate, *sharedResources);
+
+    //the dynamic bell replaces the chains' Peak, and only runs in Left/Right mode
+    design.main.setBypassed<ChainPositions::Peak>(design.stereoMode == Stereo_LeftRight
+        && design.dynamicSettings.mode == Peak_Dynamic);
+}
+
+void SimpleEQAudioProcessor::publishDesign()
+{
+    //without a sample rate there is nothing to design for yet; prepareToPlay() designs from the parameters
+    if (getSampleRate() <= 0)
+        return;
+
+    auto& design = pendingDesigns.getWriteBuffer();
+    readDesignSettings(design);
+    designChains(design);
+    pendingDesigns.finishedWrite();
+}
 
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+void SimpleEQAudioProcessor::installPendingDesign()
+{
+    if (!pendingDesigns.pull())
+        return;
 
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    //a design made before a sample rate change is stale; updateFilters() redesigns from the same parameters
+    const auto& design = pendingDesigns.getReadBuffer();
+    if (design.hostSampleRate == getSampleRate())
+        installDesign(design);
 }
 
 void SimpleEQAudioProcessor::updateFilters()
 {
-    auto chainSettings = getChainSetting(apvts);
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    SIMPLEEQ_TRACE_SCOPE("updateFilters");
+
+    auto& design = audioThreadDesign;
+    readDesignSettings(design);
+
+    //the designs only depend on the settings and the sample rate, so skip them if neither moved
+    if (design.settings == designedSettings
+        && (design.stereoMode == Stereo_LeftRight || design.sideSettings == designedSideSettings)
+        && design.stereoMode == designedStereoMode
+        && design.dynamicSettings == designedDynamicSettings
+        && design.getProcessingSampleRate() == designedSampleRate)
+        return;
+
+    designChains(design);
+    installDesign(design);
+}
+
+void SimpleEQAudioProcessor::installDesign(const ChainDesign& design)
+{
+    //L/R and M/S states don't describe the same signals, and a new factor changes what a
+    //sample is, so start from silence
+    if (design.stereoMode != designedStereoMode || design.oversamplingOrder != oversamplingOrder)
+    {
+        leftChain.reset();
+        rightChain.reset();
+        midSideKernel.reset();
+    }
+
+    if (design.oversamplingOrder != oversamplingOrder)
+    {
+        oversamplingOrder = design.oversamplingOrder;
+        if (auto* oversampler = getActiveOversampler())
+            oversampler->reset();
+    }
+
+    designedSettings = design.settings;
+    designedSideSettings = design.sideSettings;
+    designedDynamicSettings = design.dynamicSettings;
+    designedStereoMode = design.stereoMode;
+    designedSampleRate = design.getProcessingSampleRate();
+    stereoMode = design.stereoMode;
+
+    const auto wasDynamic = dynamicPeakActive;
+    dynamicPeakActive = design.main.isBypassed<ChainPositions::Peak>();
+
+    if (dynamicPeakActive)
+    {
+        dynamicPeak.setParameters(design.settings.peakFreq, design.settings.peakQuality, design.settings.peakGainInDecibels, design.dynamicSettings);
+        if (!wasDynamic)
+            dynamicPeak.reset();
+    }
+
+    //copying the coefficients keeps the filter states, so a new design never clicks
+    copyCoefficients(leftChain, design.main);
+    copyCoefficients(rightChain, stereoMode == Stereo_MidSide ? design.side : design.main);
+
+    if (stereoMode == Stereo_MidSide)
+        midSideKernel.setCoefficients(leftChain, rightChain);
+
+    publishCoefficientSnapshot();
+}
+
+void SimpleEQAudioProcessor::updateLatency()
+{
+    //the A/B slots play at the host rate, without the oversampler
+    auto* oversampler = getActiveOversampler();
+    const auto latency = oversampler != nullptr && !slotsActive ? juce::roundToInt(oversampler->getLatencyInSamples()) : 0;
+
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+namespace
+{
+    void fillCascades(CoefficientSnapshot& snapshot, const MonoChain& main, const MonoChain& side, bool dynamicPeak)
+    {
+        snapshot.main = CoefficientSnapshot::fromChain(main);
+        snapshot.side = snapshot.stereoMode == Stereo_MidSide ? CoefficientSnapshot::fromChain(side) : CoefficientSnapshot::Cascade{};
+
+        //the dynamic bell rests at Peak Gain, which is what the bypassed Peak is designed for
+        if (dynamicPeak)
+        {
+            const auto* c = main.get<ChainPositions::Peak>().coefficients->getRawCoefficients();
+            snapshot.main[4] = { c[0], c[1], c[2], c[3], c[4], true };
+        }
+    }
+}
+
+void SimpleEQAudioProcessor::publishCoefficientSnapshot()
+{
+    //installDesign() and updateSlots() are the only writers, and only run on the audio thread
+    //(or in prepareToPlay()), so this is the TripleBuffer's single producer
+    auto& snapshot = coefficientSnapshots.getWriteBuffer();
+    snapshot.version = ++lastSnapshotVersion;
+    snapshot.sampleRate = designedSampleRate;
+    snapshot.stereoMode = stereoMode;
+    snapshot.slotsPlaying = slotsActive;
+    fillCascades(snapshot, leftChain, rightChain, dynamicPeakActive);
+    coefficientSnapshots.finishedWrite();
+}
+
+CoefficientSnapshot SimpleEQAudioProcessor::designCoefficientSnapshot()
+{
+    CoefficientSnapshot snapshot;
+    snapshot.slotsPlaying = getCoefficientSnapshot().slotsPlaying;
+
+    if (getSampleRate() <= 0)
+        return snapshot;
+
+    ChainDesign design;
+    readDesignSettings(design);
+    designChains(design);
+
+    snapshot.sampleRate = design.getProcessingSampleRate();
+    snapshot.stereoMode = design.stereoMode;
+    fillCascades(snapshot, design.main, design.side, design.main.isBypassed<ChainPositions::Peak>());
+
+    return snapshot;
+}
+
+namespace
+{
+    template<typename CutType>
+    void copyCut(CoefficientSnapshot::Cascade& cascade, int firstPosition, const CutType& cut)
+    {
+        auto copyStage = [&cascade](int position, const Filter& filter, bool bypassed)
+        {
+            auto& stage = cascade[(size_t)position];
+            stage = {};
+            if (bypassed)
+                return;
+
+            const auto* c = filter.coefficients->getRawCoefficients();
+            stage = { c[0], c[1], c[2], c[3], c[4], true };
+        };
+
+        copyStage(firstPosition + 0, cut.template get<0>(), cut.template isBypassed<0>());
+        copyStage(firstPosition + 1, cut.template get<1>(), cut.template isBypassed<1>());
+        copyStage(firstPosition + 2, cut.template get<2>(), cut.template isBypassed<2>());
+        copyStage(firstPosition + 3, cut.template get<3>(), cut.template isBypassed<3>());
+    }
+}
+
+CoefficientSnapshot::Cascade CoefficientSnapshot::fromChain(const MonoChain& chain)
+{
+    Cascade cascade;
+
+    copyCut(cascade, 0, chain.get<ChainPositions::LowCut>());
+    copyCut(cascade, 5, chain.get<ChainPositions::HighCut>());
+
+    if (!chain.isBypassed<ChainPositions::Peak>())
+    {
+        const auto* c = chain.get<ChainPositions::Peak>().coefficients->getRawCoefficients();
+        cascade[4] = { c[0], c[1], c[2], c[3], c[4], true };
+    }
+
+    return cascade;
+}
+
+double CoefficientSnapshot::getMagnitudeForFrequency(const Cascade& cascade, double frequency, double sampleRate)
+{
+    if (sampleRate <= 0.0)
+        return 1.0;
+
+    //H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2) at z = e^jw
+    const auto w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    const auto z1 = std::polar(1.0, -w);
+    const auto z2 = z1 * z1;
+
+    double magnitude = 1.0;
+    for (auto& stage : cascade)
+    {
+        if (!stage.active)
+            continue;
+
+        const auto numerator = (double)stage.b0 + (double)stage.b1 * z1 + (double)stage.b2 * z2;
+        const auto denominator = 1.0 + (double)stage.a1 * z1 + (double)stage.a2 * z2;
+        magnitude *= std::abs(numerator / denominator);
+    }
+
+    return magnitude;
 }
 
 
@@ -317,6 +1134,65 @@ juce::AudioProcessorValueTreeState::ParameterLayout
     layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Slope", "LowCut Slope", stringArray, 0));
     layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Slope", "HighCut Slope", stringArray, 0));
 
+    //bilinear transform, or biquads matched to the analog responses up to Nyquist
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Filter Design", "Filter Design", juce::StringArray{ "Bilinear", "Matched" }, 0));
+
+    //in Mid/Side mode the bands above filter the mid signal and the "Side" bands below the side signal
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Stereo Mode", "Stereo Mode", juce::StringArray{ "Left/Right", "Mid/Side" }, 0));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side LowCut Freq",
+                                                           "Side LowCut Freq",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                           20.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side HighCut Freq",
+                                                           "Side HighCut Freq",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                           20000.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side Peak Freq",
+                                                           "Side Peak Freq",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f),
+                                                           750.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side Peak Gain",
+                                                           "Side Peak Gain",
+                                                           juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
+                                                           0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side Peak Quality",
+                                                           "Side Peak Quality",
+                                                           juce::NormalisableRange<float>(0.1f, 10.f, 0.5f, 1.f),
+                                                           1.f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Side LowCut Slope", "Side LowCut Slope", stringArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Side HighCut Slope", "Side HighCut Slope", stringArray, 0));
+
+    //Dynamic turns the Peak band into a dynamic EQ: its gain moves by the range once the band's level passes the threshold
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Peak Mode", "Peak Mode", juce::StringArray{ "Static", "Dynamic" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Dynamic Source", "Dynamic Source", juce::StringArray{ "Input", "Sidechain" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dynamic Threshold",
+                                                           "Dynamic Threshold",
+                                                           juce::NormalisableRange<float>(-60.f, 0.f, 0.5f, 1.f),
+                                                           -24.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dynamic Range",
+                                                           "Dynamic Range",
+                                                           juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
+                                                           -6.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dynamic Attack",
+                                                           "Dynamic Attack",
+                                                           juce::NormalisableRange<float>(0.1f, 100.f, 0.1f, 0.4f),
+                                                           5.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dynamic Release",
+                                                           "Dynamic Release",
+                                                           juce::NormalisableRange<float>(5.f, 1000.f, 1.f, 0.4f),
+                                                           100.f));
+
+    //runs the filters at 2, 4 or 8 times the host rate, for cleaner highs near Nyquist at the cost of CPU and latency
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", juce::StringArray{ "Off", "2x", "4x", "8x" }, 0));
+
+    //A/B plays the two stored slots instead of the settings above; Morph 0 is A, 1 is B
+    layout.add(std::make_unique<juce::AudioParameterChoice>("A/B", "A/B", juce::StringArray{ "Off", "On" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("A/B Morph",
+                                                           "A/B Morph",
+                                                           juce::NormalisableRange<float>(0.f, 1.f, 0.01f, 1.f),
+                                                           0.f));
+
 
 
     return layout;
@@ -9,6 +9,11 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SharedDSPResources.h"
+#include "MatchedFilterDesign.h"
+#include "LevelMeter.h"
+#include "DynamicPeak.h"
+#include "StateFormat.h"
 
 
 #include <array>
@@ -69,12 +74,87 @@ struct Fifo
     {
         return fifo.getNumReady();
     }
+
+    /**
+     drops everything waiting to be read. Only call this from the reading thread.
+     */
+    void discardAvailable()
+    {
+        fifo.finishedRead(fifo.getNumReady());
+    }
 private:
     static constexpr int Capacity = 30;
     std::array<T, Capacity> buffers;
     juce::AbstractFifo fifo{ Capacity };
 };
 
+//==============================================================================
+/**
+ a wait-free single-writer/single-reader mailbox that only keeps the newest item.
+
+ The writer fills getWriteBuffer() in place and publishes it with
+ finishedWrite(); the reader calls pull() and then reads getReadBuffer(),
+ which stays untouched until the reader's next pull(). Three slots are all
+ it takes, and nothing is ever copied between them.
+ */
+template<typename T>
+struct TripleBuffer
+{
+    void prepare(size_t numElements)
+    {
+        static_assert(std::is_same_v<T, std::vector<float>>,
+            "prepare(numElements) should only be used when the TripleBuffer is holding std::vector<float>");
+        for (auto& buffer : buffers)
+        {
+            buffer.clear();
+            buffer.resize(numElements, 0);
+        }
+    }
+
+    //==============================================================================
+    T& getWriteBuffer() { return buffers[writeIndex]; }
+
+    void finishedWrite()
+    {
+        auto previous = middle.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    //==============================================================================
+    bool hasNewData() const { return (middle.load(std::memory_order_acquire) & newDataFlag) != 0; }
+
+    /**
+     makes the newest published item the read buffer. Returns false if nothing
+     was published since the last pull.
+     */
+    bool pull()
+    {
+        if (!hasNewData())
+            return false;
+
+        auto previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    const T& getReadBuffer() const { return buffers[readIndex]; }
+
+    /** visits all three buffers; only while neither the producer nor the consumer is running. */
+    template<typename Visitor>
+    void forEachBuffer(Visitor&& visit)
+    {
+        for (auto& buffer : buffers)
+            visit(buffer);
+    }
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    std::array<T, 3> buffers;
+    int writeIndex = 0, readIndex = 1;
+    std::atomic<int> middle{ 2 };
+};
+
 enum Channel
 {
     Right, //effectively 0
@@ -94,13 +174,31 @@ struct SingleChannelSampleFifo
         jassert(prepared.get());
         jassert(buffer.getNumChannels() > channelToUse);
         auto* channelPtr = buffer.getReadPointer(channelToUse);
+        auto* fillPtr = bufferToFill.getWritePointer(0);
+        const auto numSamples = buffer.getNumSamples();
+        const auto fillSize = bufferToFill.getNumSamples();
 
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        //copy in runs up to the end of bufferToFill, pushing it once it is full
+        for (int i = 0; i < numSamples;)
         {
-            pushNextSampleIntoFifo(channelPtr[i]);
+            if (fifoIndex == fillSize)
+            {
+                auto ok = audioBufferFifo.push(bufferToFill);
+
+                juce::ignoreUnused(ok);
+
+                fifoIndex = 0;
+            }
+
+            const auto numToCopy = juce::jmin(numSamples - i, fillSize - fifoIndex);
+            juce::FloatVectorOperations::copy(fillPtr + fifoIndex, channelPtr + i, numToCopy);
+
+            fifoIndex += numToCopy;
+            i += numToCopy;
         }
     }
 
+    /** allocates, so call it before a reader can be draining the FIFO. */
     void prepare(int bufferSize)
     {
         prepared.set(false);
@@ -121,6 +219,12 @@ struct SingleChannelSampleFifo
     int getSize() const { return size.get(); }
     //==============================================================================
     bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
+
+    /** writer side: forgets the partially filled buffer, so the next complete one holds only fresh samples. */
+    void restart() { fifoIndex = 0; }
+
+    /** reader side: throws away complete buffers that were pushed before the reader attached. */
+    void discardAvailableBuffers() { audioBufferFifo.discardAvailable(); }
 private:
     Channel channelToUse;
     int fifoIndex = 0;
@@ -128,21 +232,6 @@ private:
     BlockType bufferToFill;
     juce::Atomic<bool> prepared = false;
     juce::Atomic<int> size = 0;
-
-    void pushNextSampleIntoFifo(float sample)
-    {
-        if (fifoIndex == bufferToFill.getNumSamples())
-        {
-            auto ok = audioBufferFifo.push(bufferToFill);
-
-            juce::ignoreUnused(ok);
-
-            fifoIndex = 0;
-        }
-
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
-    }
 };
 
 enum Slope
@@ -153,15 +242,80 @@ enum Slope
     Slope_48
 };
 
+enum DesignMode
+{
+    Design_Bilinear,
+    Design_Matched
+};
+
 struct ChainSettings
 {
     float peakFreq{ 0 }, peakGainInDecibels{ 0 }, peakQuality{ 1.f };
     float lowCutFreq{ 0 }, highCutFreq{ 0 };
     Slope lowCutSlope{ Slope::Slope_12 }, highCutSlope{ Slope::Slope_12 };
+    DesignMode designMode{ DesignMode::Design_Bilinear };
+
+    bool operator==(const ChainSettings& other) const
+    {
+        return peakFreq == other.peakFreq
+            && peakGainInDecibels == other.peakGainInDecibels
+            && peakQuality == other.peakQuality
+            && lowCutFreq == other.lowCutFreq
+            && highCutFreq == other.highCutFreq
+            && lowCutSlope == other.lowCutSlope
+            && highCutSlope == other.highCutSlope
+            && designMode == other.designMode;
+    }
+
+    bool operator!=(const ChainSettings& other) const { return !(*this == other); }
 };
 
 ChainSettings getChainSetting(juce::AudioProcessorValueTreeState& apvts);
 
+/** the settings of the side chain, used in mid/side mode (the main ones then act on mid). */
+ChainSettings getSideChainSetting(juce::AudioProcessorValueTreeState& apvts);
+
+/**
+ the same, read through getValue(parameterID), so the values can come from
+ somewhere else than the live parameters, e.g. a stored A/B slot.
+ */
+template<typename GetValue>
+ChainSettings readChainSetting(GetValue&& getValue)
+{
+    ChainSettings settings;
+
+    settings.peakFreq = getValue("Peak Freq");
+    settings.peakGainInDecibels = getValue("Peak Gain");
+    settings.peakQuality = getValue("Peak Quality");
+    settings.lowCutFreq = getValue("LowCut Freq");
+    settings.highCutFreq = getValue("HighCut Freq");
+    settings.lowCutSlope = static_cast<Slope>(getValue("LowCut Slope"));
+    settings.highCutSlope = static_cast<Slope>(getValue("HighCut Slope"));
+    settings.designMode = static_cast<DesignMode>(getValue("Filter Design"));
+
+    return settings;
+}
+
+template<typename GetValue>
+ChainSettings readSideChainSetting(GetValue&& getValue)
+{
+    ChainSettings settings;
+
+    settings.peakFreq = getValue("Side Peak Freq");
+    settings.peakGainInDecibels = getValue("Side Peak Gain");
+    settings.peakQuality = getValue("Side Peak Quality");
+    settings.lowCutFreq = getValue("Side LowCut Freq");
+    settings.highCutFreq = getValue("Side HighCut Freq");
+    settings.lowCutSlope = static_cast<Slope>(getValue("Side LowCut Slope"));
+    settings.highCutSlope = static_cast<Slope>(getValue("Side HighCut Slope"));
+    settings.designMode = static_cast<DesignMode>(getValue("Filter Design"));
+
+    return settings;
+}
+
+/** whether the Peak band is dynamic, and its detector and envelope settings. */
+DynamicSettings getDynamicSetting(juce::AudioProcessorValueTreeState& apvts);
+
 using Filter = juce::dsp::IIR::Filter<float>;
 using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
 using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
@@ -174,12 +328,17 @@ enum ChainPositions
 };
 
 using Coefficients = Filter::CoefficientsPtr;
-void updateCoefficients(Coefficients& old, Coefficients& replacement);
+void updateCoefficients(Coefficients& old, const Coefficients& replacement);
 
 Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
 
 inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
 {
+    if (chainSettings.designMode == Design_Matched)
+        return MatchedFilterDesign::designHighpassButterworth(chainSettings.lowCutFreq,
+            sampleRate,
+            2 * (chainSettings.lowCutSlope + 1));
+
     return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
         sampleRate,
         2 * (chainSettings.lowCutSlope + 1));
@@ -187,11 +346,46 @@ inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRa
 
 inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
 {
+    if (chainSettings.designMode == Design_Matched)
+        return MatchedFilterDesign::designLowpassButterworth(chainSettings.highCutFreq,
+            sampleRate,
+            2 * (chainSettings.highCutSlope + 1));
+
     return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
         sampleRate,
         2 * (chainSettings.highCutSlope + 1));
 }
 
+/**
+ designs every band of chainSettings and loads them into chain, the same way
+ SimpleEQAudioProcessor::updateFilters() does for each of its channels.
+ */
+void updateMonoChain(MonoChain& chain, const ChainSettings& chainSettings, double sampleRate);
+void updateMonoChain(MonoChain& chain, const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources);
+
+/**
+ copies source's coefficients and bypass flags into chain, whose filter states carry on.
+ This runs on the audio thread, so it only ever copies in place: chain must have been
+ through prepareBiquadCoefficients().
+ */
+void copyCoefficients(MonoChain& chain, const MonoChain& source);
+
+/**
+ gives every filter of chain its own biquad-sized coefficient array. A default Filter
+ holds a first-order one, so the first design copied into it would have to allocate.
+ */
+void prepareBiquadCoefficients(MonoChain& chain);
+
+//==============================================================================
+/*
+ the same designs, looked up in (and added to) the process-wide cache first.
+ */
+using CutCoefficients = SharedDSPResources::DesignedCoefficients;
+
+Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources);
+CutCoefficients makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources);
+CutCoefficients makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate, SharedDSPResources& sharedResources);
+
 template<int Index, typename ChainType, typename CoefficientType>
 void update(ChainType& chain, const CoefficientType& coefficients)
 {
@@ -230,6 +424,145 @@ void updateCutFilter(ChainType& chain,
     }
 }
 
+//==============================================================================
+/**
+ runs a mid chain and a side chain over a stereo pair in one pass: every sample
+ is encoded to M/S, filtered by both cascades and decoded back to L/R before the
+ next one, so M/S costs no extra passes over the buffer compared to plain L/R.
+
+ The coefficients are copied from two designed MonoChains (bypassed stages are
+ skipped); the kernel keeps its own filter states, one per chain position, so a
+ stage keeps its state when the slopes change just like in a MonoChain.
+ */
+struct MidSideKernel
+{
+    static constexpr int numPositions = 9;   // 4 low cut stages, the peak, 4 high cut stages
+
+    void setCoefficients(const MonoChain& midChain, const MonoChain& sideChain)
+    {
+        loadCascade(midChain, mid);
+        loadCascade(sideChain, side);
+    }
+
+    void reset()
+    {
+        for (auto* cascade : { &mid, &side })
+            for (auto& stage : cascade->stages)
+                stage.s1 = stage.s2 = 0.f;
+    }
+
+    void process(float* left, float* right, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto m = 0.5f * (left[i] + right[i]);
+            auto s = 0.5f * (left[i] - right[i]);
+
+            m = mid.processSample(m);
+            s = side.processSample(s);
+
+            left[i] = m + s;
+            right[i] = m - s;
+        }
+    }
+private:
+    struct Stage
+    {
+        float b0 = 1.f, b1 = 0.f, b2 = 0.f, a1 = 0.f, a2 = 0.f;
+        float s1 = 0.f, s2 = 0.f;
+    };
+
+    struct Cascade
+    {
+        std::array<Stage, numPositions> stages;
+        std::array<int, numPositions> active{};
+        int numActive = 0;
+
+        float processSample(float x) noexcept
+        {
+            //transposed direct form II, the same as juce::dsp::IIR::Filter
+            for (int k = 0; k < numActive; ++k)
+            {
+                auto& q = stages[(size_t)active[(size_t)k]];
+                const auto y = q.b0 * x + q.s1;
+                q.s1 = q.b1 * x - q.a1 * y + q.s2;
+                q.s2 = q.b2 * x - q.a2 * y;
+                x = y;
+            }
+
+            return x;
+        }
+    };
+
+    Cascade mid, side;
+
+    static void loadStage(Cascade& cascade, int position, const Filter& filter)
+    {
+        const auto* c = filter.coefficients->getRawCoefficients();
+        auto& stage = cascade.stages[(size_t)position];
+        stage.b0 = c[0];
+        stage.b1 = c[1];
+        stage.b2 = c[2];
+        stage.a1 = c[3];
+        stage.a2 = c[4];
+
+        cascade.active[(size_t)cascade.numActive++] = position;
+    }
+
+    template<typename CutType>
+    static void loadCut(Cascade& cascade, int firstPosition, const CutType& cut)
+    {
+        if (!cut.template isBypassed<0>()) loadStage(cascade, firstPosition + 0, cut.template get<0>());
+        if (!cut.template isBypassed<1>()) loadStage(cascade, firstPosition + 1, cut.template get<1>());
+        if (!cut.template isBypassed<2>()) loadStage(cascade, firstPosition + 2, cut.template get<2>());
+        if (!cut.template isBypassed<3>()) loadStage(cascade, firstPosition + 3, cut.template get<3>());
+    }
+
+    static void loadCascade(const MonoChain& chain, Cascade& cascade)
+    {
+        cascade.numActive = 0;
+
+        loadCut(cascade, 0, chain.get<ChainPositions::LowCut>());
+
+        if (!chain.isBypassed<ChainPositions::Peak>())
+            loadStage(cascade, 4, chain.get<ChainPositions::Peak>());
+
+        loadCut(cascade, 5, chain.get<ChainPositions::HighCut>());
+    }
+};
+
+enum StereoMode
+{
+    Stereo_LeftRight,
+    Stereo_MidSide
+};
+
+//==============================================================================
+/**
+ a copy of the coefficients the processor is running, published whenever
+ the audio thread installs a design so the editor can draw exactly what is applied without
+ designing anything itself. Plain data, so publishing never allocates.
+ */
+struct CoefficientSnapshot
+{
+    struct Stage
+    {
+        float b0 = 1.f, b1 = 0.f, b2 = 0.f, a1 = 0.f, a2 = 0.f;
+        bool active = false;
+    };
+
+    using Cascade = std::array<Stage, MidSideKernel::numPositions>;
+
+    juce::uint32 version = 0;          // 0 until the first publication
+    double sampleRate = 0.0;
+    StereoMode stereoMode = Stereo_LeftRight;
+    Cascade main, side;                // side is only set in mid/side mode
+    bool slotsPlaying = false;         // the A/B slots are heard, not main/side
+
+    static Cascade fromChain(const MonoChain& chain);
+    static double getMagnitudeForFrequency(const Cascade& cascade, double frequency, double sampleRate);
+};
+
 //==============================================================================
 /**
 */
@@ -278,19 +611,186 @@ public:
 
     using BlockType = juce::AudioBuffer<float>;
     SingleChannelSampleFifo<BlockType> leftChannelFifo{ Channel::Left };
-    SingleChannelSampleFifo<BlockType> rightChannelFifo{ Channel::Right };
+
+    /**
+     the analyzer FIFO is only filled while at least one analyzer consumer
+     (e.g. an open editor) is registered. Call these from the message thread.
+     */
+    void addAnalyzerConsumer();
+    void removeAnalyzerConsumer();
+
+    /**
+     the chains run on a fixed grid of this many samples, whatever the host sends:
+     large blocks are split into sub-blocks and parameter changes are picked up at
+     each grid point, while short slivers only do the bookkeeping when they cross one.
+     */
+    static constexpr int subBlockSize = 64;
+
+    /** size of the buffers handed to the analyzer, independent of the host's block size. */
+    static constexpr int analyzerBufferSize = 512;
+
+    /**
+     levels before and after the EQ, measured in processBlock() only while at
+     least one meter consumer is registered. Call these from the message thread.
+     */
+    LevelMeter inputMeter, outputMeter;
+
+    void addMeterConsumer();
+    void removeMeterConsumer();
+
+    /**
+     the coefficients of the last installed design. Call both from the message
+     thread only: pull returns true if a new snapshot became readable.
+     */
+    bool pullCoefficientSnapshot() { return coefficientSnapshots.pull(); }
+    const CoefficientSnapshot& getCoefficientSnapshot() const { return coefficientSnapshots.getReadBuffer(); }
+
+    /**
+     designs the current parameters on the calling thread, the way the audio thread
+     would, and returns them as an unpublished snapshot (version 0). Only processBlock()
+     publishes, so this is for an editor to draw while no blocks are coming.
+     Message thread only.
+     */
+    CoefficientSnapshot designCoefficientSnapshot();
+
+    /**
+     A/B slots. storeSlot() keeps the current settings in slot 0 (A) or 1 (B)
+     and designs its filters right away; once both are stored, turning "A/B"
+     on runs both designs side by side and "A/B Morph" crossfades between
+     them on the audio thread, so a switch never designs or parses anything.
+     Call these from the message thread.
+     */
+    static constexpr int numSlots = CompactStateFormat::numSlots;
+    void storeSlot(int slot);
+    bool isSlotStored(int slot) const
+    {
+        const juce::ScopedLock sl(designWriterLock);
+        return storedSlots.hasSlot[(size_t)slot];
+    }
+
+    /** the "Oversampling" parameter runs the chains at up to 2^maxOversamplingOrder times the host rate. */
+    static constexpr int maxOversamplingOrder = 3;
 
 private:
+    int samplesUntilNextUpdate = 0;
+
+    std::atomic<int> numAnalyzerConsumers{ 0 };
+
+    //bumped by every addAnalyzerConsumer(); the audio thread restarts the FIFO when it moves
+    std::atomic<juce::uint32> analyzerGeneration{ 0 };
+    juce::uint32 pushedAnalyzerGeneration = 0;
+
+    std::atomic<int> numMeterConsumers{ 0 };
+    bool meteringWasActive = false;
 
+    juce::SharedResourcePointer<SharedDSPResources> sharedResources;
+
+    //what leftChain and rightChain were last designed for
+    ChainSettings designedSettings, designedSideSettings;
+    DynamicSettings designedDynamicSettings;
+    StereoMode designedStereoMode = Stereo_LeftRight;
+    double designedSampleRate = 0.0;
+
+    //in mid/side mode leftChain holds the mid design and rightChain the side design,
+    //and midSideKernel runs a copy of their coefficients
     MonoChain leftChain, rightChain;
+    MidSideKernel midSideKernel;
+    StereoMode stereoMode = Stereo_LeftRight;
+
+    //in dynamic mode (Left/Right only) the chains' Peak is bypassed and this bell runs after them
+    DynamicPeakFilter dynamicPeak;
+    bool dynamicPeakActive = false;
+
+    //one polyphase IIR half-band cascade per factor, so a change of factor allocates nothing;
+    //the chains and midSideKernel are designed for, and run at, the oversampled rate
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, maxOversamplingOrder> oversamplers;
+    int oversamplingOrder = 0;
+
+    juce::dsp::Oversampling<float>* getActiveOversampler() const
+    {
+        return oversamplingOrder > 0 ? oversamplers[(size_t)oversamplingOrder - 1].get() : nullptr;
+    }
+
+    void updateLatency();
+
+    TripleBuffer<CoefficientSnapshot> coefficientSnapshots;
+    juce::uint32 lastSnapshotVersion = 0;
+
+    CompactStateFormat stateFormat{ *this };
+
+    //the slots' values (the live ones are unused), and their designs on their way to the audio thread
+    CompactStateFormat::State storedSlots;
+
+    struct SlotDesign
+    {
+        MonoChain main, side;
+        StereoMode stereoMode = Stereo_LeftRight;
+        bool stored = false;        // false tells the audio thread the slot was emptied
+    };
+
+    std::array<TripleBuffer<SlotDesign>, numSlots> slotDesigns;
+
+    //the audio thread's copy of each slot, with its own filter states
+    struct SlotFilters
+    {
+        MonoChain left, right;
+        MidSideKernel midSide;
+        StereoMode stereoMode = Stereo_LeftRight;
+        bool designed = false;
+    };
+
+    std::array<SlotFilters, numSlots> slotFilters;
+    juce::AudioBuffer<float> morphBuffer;
+    juce::SmoothedValue<float> morph;
+    bool slotsActive = false;
+
+    //0 plays the chains, 1 the slots; in between "A/B" was just switched and both run
+    juce::SmoothedValue<float> slotsMix;
+    juce::AudioBuffer<float> crossfadeBuffer;
+
+    /** designs a stored slot, or publishes an empty design for one that isn't. Takes designWriterLock. */
+    void designSlot(int slot);
+    void updateSlots();
+    void processSlots(juce::dsp::AudioBlock<float>& block);
+    void processChains(juce::dsp::AudioBlock<float>& subBlock, const juce::AudioBuffer<float>& sidechain, int start);
+
+    void publishCoefficientSnapshot();
+
+    /**
+     everything the main chains are designed from, and the designs. A preset load
+     builds one on its own thread and publishes it through pendingDesigns; the
+     audio thread adopts it at the next grid point by copying coefficients into
+     its chains, so nothing it is filtering with is ever touched from outside.
+     updateFilters() goes through the same path with a design of its own.
+     */
+    struct ChainDesign
+    {
+        ChainSettings settings, sideSettings;
+        DynamicSettings dynamicSettings;
+        StereoMode stereoMode = Stereo_LeftRight;
+        int oversamplingOrder = 0;
+        double hostSampleRate = 0.0;
+
+        //main runs on both channels in Left/Right mode, on mid in Mid/Side mode
+        MonoChain main, side;
+
+        double getProcessingSampleRate() const { return hostSampleRate * (1 << oversamplingOrder); }
+    };
 
-    void updatePeakFilter(const ChainSettings& chainSettings);
+    TripleBuffer<ChainDesign> pendingDesigns;
+    ChainDesign audioThreadDesign;
 
+    //serialises the producers of pendingDesigns and slotDesigns, and guards storedSlots;
+    //the audio thread never takes it
+    mutable juce::CriticalSection designWriterLock;
 
-    
+    void readDesignSettings(ChainDesign& design);
+    void designChains(ChainDesign& design);
+    void installDesign(const ChainDesign& design);
 
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
+    /** call with designWriterLock held, after the parameters were set. */
+    void publishDesign();
+    void installPendingDesign();
 
     void updateFilters();
 
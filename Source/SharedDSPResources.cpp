@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    SharedDSPResources.cpp
+
+    Immutable window tables and filter designs shared by every processor
+    and editor in the process.
+
+  ==============================================================================
+*/
+
+#include "SharedDSPResources.h"
+
+std::shared_ptr<const std::vector<float>> SharedDSPResources::getBlackmanHarrisTable(int size)
+{
+    const juce::ScopedLock lock(planLock);
+
+    auto& entry = windows[size];
+    if (auto table = entry.lock())
+        return table;
+
+    auto newTable = std::make_shared<std::vector<float>>((size_t)size);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(newTable->data(),
+        (size_t)size,
+        juce::dsp::WindowingFunction<float>::blackmanHarris);
+
+    std::shared_ptr<const std::vector<float>> table = std::move(newTable);
+    entry = table;
+    return table;
+}
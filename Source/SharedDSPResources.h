@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    SharedDSPResources.h
+
+    Immutable window tables and filter designs shared by every processor
+    and editor in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <map>
+#include <memory>
+
+//==============================================================================
+/**
+ Hold one with juce::SharedResourcePointer<SharedDSPResources>: the first
+ pointer creates it and the last one to go away deletes it.
+
+ Window tables are handed out as shared_ptrs to const objects and live as
+ long as somebody uses them, so any number of analyzers with the same FFT
+ order share one table. FFT plans are not shared: JUCE's fallback engine
+ takes a lock inside perform(), so one plan would serialise every thread
+ transforming through it. Each FFTDataGenerator makes its own.
+
+ Filter designs live in a small fixed-size table. getDesign() only try-locks
+ it, so the audio thread never waits for another instance; if the table is
+ busy the design is simply computed locally.
+ */
+class SharedDSPResources
+{
+public:
+    using DesignedCoefficients = std::array<juce::dsp::IIR::Coefficients<float>::Ptr, 4>;
+
+    struct DesignKey
+    {
+        int type = 0, mode = 0;
+        float frequency = 0, quality = 0, gainInDecibels = 0;
+        int order = 0;
+        double sampleRate = 0;
+
+        bool operator==(const DesignKey& other) const
+        {
+            return type == other.type
+                && mode == other.mode
+                && frequency == other.frequency
+                && quality == other.quality
+                && gainInDecibels == other.gainInDecibels
+                && order == other.order
+                && sampleRate == other.sampleRate;
+        }
+    };
+
+    /** a normalised Blackman-Harris table of the given size. */
+    std::shared_ptr<const std::vector<float>> getBlackmanHarrisTable(int size);
+
+    /**
+     returns the cached design for key, or calls design() and caches its result.
+     */
+    template<typename DesignFunction>
+    DesignedCoefficients getDesign(const DesignKey& key, DesignFunction&& design)
+    {
+        {
+            const juce::SpinLock::ScopedTryLockType lock(designLock);
+            if (lock.isLocked())
+            {
+                for (auto& entry : designs)
+                {
+                    if (entry.coefficients[0] != nullptr && entry.key == key)
+                        return entry.coefficients;
+                }
+            }
+        }
+
+        DesignedCoefficients coefficients = design();
+
+        //the entry pushed out may hold the last reference to its coefficients; it is moved here and
+        //freed only after the lock below is released, so no deallocation happens inside it
+        DesignedCoefficients evicted;
+        {
+            const juce::SpinLock::ScopedTryLockType lock(designLock);
+            if (lock.isLocked())
+            {
+                auto& entry = designs[(size_t)nextDesign];
+                evicted = std::move(entry.coefficients);
+                entry = { key, coefficients };
+                nextDesign = (nextDesign + 1) % numDesigns;
+            }
+        }
+
+        return coefficients;
+    }
+
+private:
+    juce::CriticalSection planLock;
+    std::map<int, std::weak_ptr<const std::vector<float>>> windows;
+
+    struct Design
+    {
+        DesignKey key;
+        DesignedCoefficients coefficients;
+    };
+
+    static constexpr int numDesigns = 64;
+    juce::SpinLock designLock;
+    std::array<Design, numDesigns> designs;
+    int nextDesign = 0;
+};
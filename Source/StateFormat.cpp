@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    StateFormat.cpp
+
+    The compact, versioned binary form of the plugin's state: the live
+    parameter values and the stored A/B slots.
+
+  ==============================================================================
+*/
+
+#include "StateFormat.h"
+
+namespace
+{
+    const char magic[4] = { 'S', 'Q', 'S', 'T' };
+}
+
+CompactStateFormat::CompactStateFormat(juce::AudioProcessor& processor)
+{
+    for (auto* parameter : processor.getParameters())
+    {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+        jassert(ranged != nullptr);
+
+        if (ranged == nullptr || (int)parameters.size() == maxParameters)
+        {
+            jassertfalse;   // raise maxParameters
+            break;
+        }
+
+        const auto index = (int)parameters.size();
+        const auto hash = (juce::uint32)ranged->paramID.hashCode();
+
+        parameters.push_back(ranged);
+        hashByIndex.push_back(hash);
+        indexByHash.emplace_back(hash, index);
+        defaults[(size_t)index] = ranged->convertFrom0to1(ranged->getDefaultValue());
+    }
+
+    std::sort(indexByHash.begin(), indexByHash.end());
+
+    //two IDs with the same hash could not be told apart in a saved state
+    jassert(std::adjacent_find(indexByHash.begin(), indexByHash.end(),
+        [](const auto& a, const auto& b) { return a.first == b.first; }) == indexByHash.end());
+}
+
+bool CompactStateFormat::isCompactState(const void* data, int sizeInBytes)
+{
+    return sizeInBytes >= (int)headerSize && std::memcmp(data, magic, sizeof(magic)) == 0;
+}
+
+void CompactStateFormat::write(const State& state, juce::MemoryBlock& destData) const
+{
+    const auto numValues = parameters.size();
+
+    juce::uint8 slotMask = 0;
+    for (int slot = 0; slot < numSlots; ++slot)
+        if (state.hasSlot[(size_t)slot])
+            slotMask |= (juce::uint8)(1 << slot);
+
+    juce::MemoryOutputStream stream(destData, false);
+    stream.write(magic, sizeof(magic));
+    stream.writeShort((short)currentVersion);
+    stream.writeByte((char)slotMask);
+    stream.writeByte(0);
+
+    auto writeValues = [&](const Values& values)
+    {
+        stream.writeShort((short)numValues);
+        for (size_t i = 0; i < numValues; ++i)
+        {
+            stream.writeInt((int)hashByIndex[i]);
+            stream.writeFloat(values[i]);
+        }
+    };
+
+    writeValues(state.live);
+    for (int slot = 0; slot < numSlots; ++slot)
+        if (state.hasSlot[(size_t)slot])
+            writeValues(state.slots[(size_t)slot]);
+}
+
+bool CompactStateFormat::read(const void* data, int sizeInBytes, State& state) const
+{
+    if (!isCompactState(data, sizeInBytes))
+        return false;
+
+    const auto* bytes = static_cast<const juce::uint8*>(data);
+    const auto size = (size_t)sizeInBytes;
+
+    const auto version = juce::ByteOrder::littleEndianShort(bytes + 4);
+    const auto slotMask = bytes[6];
+    if (version == 0 || version > currentVersion)
+        return false;
+
+    int numBlocks = 1;
+    for (int slot = 0; slot < numSlots; ++slot)
+        if ((slotMask >> slot) & 1)
+            ++numBlocks;
+
+    //first walk the blocks to check they all fit, so a truncated state changes nothing
+    auto position = headerSize;
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        if (position + 2 > size)
+            return false;
+
+        const auto count = (size_t)juce::ByteOrder::littleEndianShort(bytes + position);
+        position += 2 + count * entrySize;
+        if (position > size)
+            return false;
+    }
+
+    position = headerSize;
+    auto readValues = [&](Values& values)
+    {
+        values = defaults;
+
+        const auto count = (size_t)juce::ByteOrder::littleEndianShort(bytes + position);
+        position += 2;
+
+        for (size_t i = 0; i < count; ++i, position += entrySize)
+        {
+            const auto index = findIndex(juce::ByteOrder::littleEndianInt(bytes + position));
+            if (index < 0)
+                continue;
+
+            const auto bits = juce::ByteOrder::littleEndianInt(bytes + position + 4);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+
+            values[(size_t)index] = parameters[(size_t)index]->getNormalisableRange().snapToLegalValue(value);
+        }
+    };
+
+    readValues(state.live);
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        state.hasSlot[(size_t)slot] = ((slotMask >> slot) & 1) != 0;
+        if (state.hasSlot[(size_t)slot])
+            readValues(state.slots[(size_t)slot]);
+    }
+
+    return true;
+}
+
+CompactStateFormat::Values CompactStateFormat::capture() const
+{
+    Values values = defaults;
+    for (size_t i = 0; i < parameters.size(); ++i)
+        values[i] = parameters[i]->convertFrom0to1(parameters[i]->getValue());
+
+    return values;
+}
+
+void CompactStateFormat::apply(const Values& values) const
+{
+    for (size_t i = 0; i < parameters.size(); ++i)
+        parameters[i]->setValueNotifyingHost(parameters[i]->convertTo0to1(values[i]));
+}
+
+float CompactStateFormat::getValue(const Values& values, juce::StringRef parameterID) const
+{
+    for (size_t i = 0; i < parameters.size(); ++i)
+        if (parameters[i]->paramID == parameterID)
+            return values[i];
+
+    jassertfalse;
+    return 0.f;
+}
+
+int CompactStateFormat::findIndex(juce::uint32 hash) const
+{
+    auto it = std::lower_bound(indexByHash.begin(), indexByHash.end(), std::make_pair(hash, 0));
+    return it != indexByHash.end() && it->first == hash ? it->second : -1;
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    StateFormat.h
+
+    The compact, versioned binary form of the plugin's state: the live
+    parameter values and the stored A/B slots.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <array>
+#include <vector>
+
+//==============================================================================
+/**
+ Layout, little endian:
+
+     char[4]   "SQST"
+     uint16    version
+     uint8     slot mask, bit n set if slot n is stored
+     uint8     reserved, 0
+     then the live values and each stored slot, each as
+     uint16    count
+     count x   { uint32 hash of the parameter ID, float32 plain value }
+
+ Values are matched by the hash of their parameter ID, so parameters can be
+ added, removed or reordered without breaking older states: unknown IDs are
+ skipped and missing ones get their default.
+
+ read() parses straight into fixed-size arrays and never allocates; it checks
+ the whole layout before touching the destination, so malformed data leaves
+ it as it was.
+ */
+class CompactStateFormat
+{
+public:
+    static constexpr int maxParameters = 64;
+    static constexpr int numSlots = 2;
+    static constexpr juce::uint16 currentVersion = 1;
+
+    /** plain (denormalised) values, indexed like the processor's parameters. */
+    using Values = std::array<float, maxParameters>;
+
+    struct State
+    {
+        Values live{};
+        std::array<Values, numSlots> slots{};
+        std::array<bool, numSlots> hasSlot{};
+    };
+
+    /** call once the processor's parameters have all been added. */
+    explicit CompactStateFormat(juce::AudioProcessor& processor);
+
+    static bool isCompactState(const void* data, int sizeInBytes);
+
+    void write(const State& state, juce::MemoryBlock& destData) const;
+    bool read(const void* data, int sizeInBytes, State& state) const;
+
+    /** the parameters' current values. */
+    Values capture() const;
+
+    /** sets every parameter to values, notifying the host. */
+    void apply(const Values& values) const;
+
+    /** the value of the parameter with this ID, or 0 if there is none. */
+    float getValue(const Values& values, juce::StringRef parameterID) const;
+
+private:
+    static constexpr size_t headerSize = 8;
+    static constexpr size_t entrySize = 8;
+
+    std::vector<juce::RangedAudioParameter*> parameters;
+
+    //sorted by hash, for the lookups while reading
+    std::vector<std::pair<juce::uint32, int>> indexByHash;
+    std::vector<juce::uint32> hashByIndex;
+
+    Values defaults{};
+
+    int findIndex(juce::uint32 hash) const;
+};
@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    Trace.cpp
+
+    Optional timeline tracing of the audio and UI threads, written out as a
+    Chrome/Perfetto compatible JSON file.
+
+  ==============================================================================
+*/
+
+#include "Trace.h"
+
+#if SIMPLEEQ_ENABLE_TRACE
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        juce::int64 ticks;
+        bool isBegin;
+    };
+
+    /**
+     the owning thread's ring of events. Its slots are relaxed atomics because
+     writeToFile() copies them while the owner may be overwriting the oldest
+     ones; numWritten tells it afterwards which of its copies to trust.
+     */
+    struct ThreadBuffer
+    {
+        static constexpr juce::uint64 capacity = 1 << 16;
+
+        struct Slot
+        {
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<juce::int64> ticks{ 0 };
+            std::atomic<bool> isBegin{ false };
+        };
+
+        std::unique_ptr<Slot[]> events{ new Slot[(size_t)capacity] };
+        std::atomic<juce::uint64> numWritten{ 0 };
+        int threadIndex = 0;
+        juce::String threadName;
+
+        void record(const char* name, bool isBegin) noexcept
+        {
+            const auto n = numWritten.load(std::memory_order_relaxed);
+            auto& slot = events[(size_t)(n & (capacity - 1))];
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.ticks.store(juce::Time::getHighResolutionTicks(), std::memory_order_relaxed);
+            slot.isBegin.store(isBegin, std::memory_order_relaxed);
+            numWritten.store(n + 1, std::memory_order_release);
+        }
+
+        /** seqlock-style copy: whatever the owner overwrote meanwhile is dropped. */
+        std::vector<Event> snapshot() const
+        {
+            const auto n = numWritten.load(std::memory_order_acquire);
+            const auto first = n > capacity ? n - capacity : 0;
+
+            std::vector<Event> copy;
+            copy.reserve((size_t)(n - first));
+            for (auto i = first; i < n; ++i)
+            {
+                const auto& slot = events[(size_t)(i & (capacity - 1))];
+                copy.push_back({ slot.name.load(std::memory_order_relaxed),
+                                 slot.ticks.load(std::memory_order_relaxed),
+                                 slot.isBegin.load(std::memory_order_relaxed) });
+            }
+
+            //the write of event m replaces event m - capacity, and may be under way before numWritten shows it
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const auto after = numWritten.load(std::memory_order_relaxed);
+            const auto firstIntact = after + 1 > capacity ? after + 1 - capacity : 0;
+
+            if (firstIntact > first)
+                copy.erase(copy.begin(), copy.begin() + (std::ptrdiff_t)juce::jmin(firstIntact - first, (juce::uint64)copy.size()));
+
+            return copy;
+        }
+    };
+
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    // never destroyed, so threads that outlive static destruction can still record
+    Registry& getRegistry()
+    {
+        static auto* registry = new Registry();
+        return *registry;
+    }
+
+    ThreadBuffer& getThreadBuffer() noexcept
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+
+        if (buffer == nullptr)
+        {
+            auto newBuffer = std::make_unique<ThreadBuffer>();
+
+            if (juce::MessageManager::existsAndIsCurrentThread())
+                newBuffer->threadName = "Message thread";
+            else if (auto* thread = juce::Thread::getCurrentThread())
+                newBuffer->threadName = thread->getThreadName();
+
+            auto& registry = getRegistry();
+            const std::lock_guard<std::mutex> lock(registry.lock);
+
+            newBuffer->threadIndex = (int)registry.buffers.size() + 1;
+            if (newBuffer->threadName.isEmpty())
+                newBuffer->threadName = "Thread " + juce::String(newBuffer->threadIndex);
+
+            buffer = newBuffer.get();
+            registry.buffers.push_back(std::move(newBuffer));
+        }
+
+        return *buffer;
+    }
+}
+
+void Trace::begin(const char* name) noexcept
+{
+    getThreadBuffer().record(name, true);
+}
+
+void Trace::end(const char* name) noexcept
+{
+    getThreadBuffer().record(name, false);
+}
+
+bool Trace::writeToFile(const juce::File& file)
+{
+    struct ThreadEvents
+    {
+        int threadIndex;
+        juce::String threadName;
+        std::vector<Event> events;
+    };
+
+    //copy the rings under the lock and write without it, so a thread that records its first event
+    //meanwhile (the audio thread, say) is never kept waiting on the file
+    std::vector<ThreadEvents> threads;
+    {
+        auto& registry = getRegistry();
+        const std::lock_guard<std::mutex> lock(registry.lock);
+
+        threads.reserve(registry.buffers.size());
+        for (auto& buffer : registry.buffers)
+            threads.push_back({ buffer->threadIndex, buffer->threadName, buffer->snapshot() });
+    }
+
+    //a ring that wrapped may start inside a scope: drop ends without a begin, and close what is still open
+    for (auto& thread : threads)
+    {
+        std::vector<Event> balanced;
+        balanced.reserve(thread.events.size());
+        std::vector<const char*> open;
+
+        for (auto& event : thread.events)
+        {
+            if (event.isBegin)
+                open.push_back(event.name);
+            else if (open.empty())
+                continue;
+            else
+                open.pop_back();
+
+            balanced.push_back(event);
+        }
+
+        const auto lastTicks = balanced.empty() ? 0 : balanced.back().ticks;
+        for (auto it = open.rbegin(); it != open.rend(); ++it)
+            balanced.push_back({ *it, lastTicks, false });
+
+        thread.events = std::move(balanced);
+    }
+
+    file.deleteFile();
+    juce::FileOutputStream out(file);
+    if (!out.openedOk())
+        return false;
+
+    //timestamps are written in microseconds, relative to the oldest event still held
+    auto firstTicks = std::numeric_limits<juce::int64>::max();
+    for (auto& thread : threads)
+        if (!thread.events.empty())
+            firstTicks = juce::jmin(firstTicks, thread.events.front().ticks);
+
+    const auto ticksPerMicrosecond = (double)juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+
+    out << "{\"traceEvents\":[\n";
+    bool isFirstEvent = true;
+    auto writeSeparator = [&]
+    {
+        if (!isFirstEvent)
+            out << ",\n";
+        isFirstEvent = false;
+    };
+
+    for (auto& thread : threads)
+    {
+        writeSeparator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.threadIndex
+            << ",\"args\":{\"name\":" << juce::JSON::toString(thread.threadName) << "}}";
+
+        for (auto& event : thread.events)
+        {
+            writeSeparator();
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"" << (event.isBegin ? "B" : "E")
+                << "\",\"pid\":1,\"tid\":" << thread.threadIndex
+                << ",\"ts\":" << juce::String((double)(event.ticks - firstTicks) / ticksPerMicrosecond, 3) << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    out.flush();
+    return out.getStatus().wasOk();
+}
+
+#endif
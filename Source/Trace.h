@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Trace.h
+
+    Optional timeline tracing of the audio and UI threads, written out as a
+    Chrome/Perfetto compatible JSON file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ build with SIMPLEEQ_ENABLE_TRACE=1 to record events; otherwise the macros
+ below expand to nothing.
+ */
+#ifndef SIMPLEEQ_ENABLE_TRACE
+ #define SIMPLEEQ_ENABLE_TRACE 0
+#endif
+
+#if SIMPLEEQ_ENABLE_TRACE
+
+namespace Trace
+{
+    /**
+     records a begin/end event on the calling thread. Every thread gets its own
+     ring buffer the first time it records something (that one allocation is the
+     only one); after that recording is a timestamp and a store, with no locks.
+     'name' must point to a string literal.
+     */
+    void begin(const char* name) noexcept;
+    void end(const char* name) noexcept;
+
+    /**
+     writes the events still held by every thread's buffer as a trace event JSON
+     file, viewable in chrome://tracing or ui.perfetto.dev. Events recorded while
+     it runs may or may not be included. The buffers are copied first and the
+     file written afterwards, so recording threads never wait on the file.
+     */
+    bool writeToFile(const juce::File& file);
+
+    struct ScopedEvent
+    {
+        explicit ScopedEvent(const char* eventName) noexcept : name(eventName) { begin(name); }
+        ~ScopedEvent() { end(name); }
+
+        const char* name;
+    };
+}
+
+ #define SIMPLEEQ_TRACE_SCOPE(name) const Trace::ScopedEvent JUCE_JOIN_MACRO(traceEvent_, __LINE__) (name)
+
+#else
+
+ #define SIMPLEEQ_TRACE_SCOPE(name)
+
+#endif
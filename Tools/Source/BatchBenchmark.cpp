@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    BatchBenchmark.cpp
+
+    Compares BatchEQ with the one-plugin-instance-per-stream baseline, and
+    with one bare MonoChain per stream.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/BatchEQ.h"
+
+namespace
+{
+    ChainSettings makeRandomSettings(juce::Random& random)
+    {
+        ChainSettings settings;
+        settings.lowCutFreq = 20.f + random.nextFloat() * 480.f;
+        settings.highCutFreq = 2000.f + random.nextFloat() * 18000.f;
+        settings.peakFreq = 50.f + random.nextFloat() * 15000.f;
+        settings.peakGainInDecibels = random.nextFloat() * 48.f - 24.f;
+        settings.peakQuality = 0.1f + random.nextFloat() * 9.9f;
+        settings.lowCutSlope = static_cast<Slope>(random.nextInt(4));
+        settings.highCutSlope = static_cast<Slope>(random.nextInt(4));
+        return settings;
+    }
+
+    /** rounds settings the way the plugin's parameters would, so every path filters with the same ones. */
+    ChainSettings snapToParameters(ChainSettings settings, juce::AudioProcessorValueTreeState& apvts)
+    {
+        auto snap = [&apvts](const char* parameterID, float value)
+        {
+            auto* parameter = apvts.getParameter(parameterID);
+            return parameter->convertFrom0to1(parameter->convertTo0to1(value));
+        };
+
+        settings.lowCutFreq = snap("LowCut Freq", settings.lowCutFreq);
+        settings.highCutFreq = snap("HighCut Freq", settings.highCutFreq);
+        settings.peakFreq = snap("Peak Freq", settings.peakFreq);
+        settings.peakGainInDecibels = snap("Peak Gain", settings.peakGainInDecibels);
+        settings.peakQuality = snap("Peak Quality", settings.peakQuality);
+        return settings;
+    }
+
+    void applySettings(SimpleEQAudioProcessor& processor, const ChainSettings& settings)
+    {
+        auto set = [&processor](const char* parameterID, float value)
+        {
+            auto* parameter = processor.apvts.getParameter(parameterID);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+
+        set("LowCut Freq", settings.lowCutFreq);
+        set("LowCut Slope", (float)settings.lowCutSlope);
+        set("HighCut Freq", settings.highCutFreq);
+        set("HighCut Slope", (float)settings.highCutSlope);
+        set("Peak Freq", settings.peakFreq);
+        set("Peak Gain", settings.peakGainInDecibels);
+        set("Peak Quality", settings.peakQuality);
+    }
+
+    float getMaxDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        float maxError = 0.f;
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            for (int i = 0; i < a.getNumSamples(); ++i)
+                maxError = juce::jmax(maxError, std::abs(a.getSample(ch, i) - b.getSample(ch, i)));
+
+        return maxError;
+    }
+
+    template<typename Function>
+    double timeBlocks(int numBlocks, Function&& processOneBlock)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+            processOneBlock();
+
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    }
+}
+
+int runBatchBenchmark(const juce::StringArray& args)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const auto numStreams = getIntOption(args, "streams", 256);
+    const auto blockSize = getIntOption(args, "block", 256);
+    const auto seconds = getIntOption(args, "seconds", 10);
+    const auto numThreads = getIntOption(args, "threads", juce::SystemStats::getNumCpus());
+    const auto tolerance = (float)getStringOption(args, "tolerance", "1e-4").getDoubleValue();
+    const double sampleRate = 48000.0;
+    const auto numBlocks = int(seconds * sampleRate) / blockSize;
+
+    //the baseline: what a host running one plugin instance per stream would do
+    std::vector<std::unique_ptr<SimpleEQAudioProcessor>> processors;
+    for (int i = 0; i < numStreams; ++i)
+        processors.push_back(std::make_unique<SimpleEQAudioProcessor>());
+
+    juce::Random random(0x5eed);
+    std::vector<ChainSettings> settings;
+    for (int i = 0; i < numStreams; ++i)
+        settings.push_back(snapToParameters(makeRandomSettings(random), processors[(size_t)i]->apvts));
+
+    for (int i = 0; i < numStreams; ++i)
+    {
+        auto& processor = *processors[(size_t)i];
+        applySettings(processor, settings[(size_t)i]);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+    }
+
+    juce::AudioBuffer<float> source(numStreams, blockSize), buffer(numStreams, blockSize);
+    for (int ch = 0; ch < numStreams; ++ch)
+        for (int i = 0; i < blockSize; ++i)
+            source.setSample(ch, i, random.nextFloat() * 2.f - 1.f);
+
+    //each instance gets its stream on both channels, and the left one is kept
+    juce::AudioBuffer<float> stereo(2, blockSize);
+    juce::MidiBuffer midi;
+
+    auto processProcessors = [&]
+    {
+        buffer.makeCopyOf(source, true);
+        for (int i = 0; i < numStreams; ++i)
+        {
+            stereo.copyFrom(0, 0, buffer, i, 0, blockSize);
+            stereo.copyFrom(1, 0, buffer, i, 0, blockSize);
+            processors[(size_t)i]->processBlock(stereo, midi);
+            buffer.copyFrom(i, 0, stereo, 0, 0, blockSize);
+        }
+    };
+
+    //==============================================================================
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = blockSize;
+    spec.numChannels = 1;
+    spec.sampleRate = sampleRate;
+
+    std::vector<MonoChain> chains((size_t)numStreams);
+    for (int i = 0; i < numStreams; ++i)
+    {
+        chains[(size_t)i].prepare(spec);
+        updateMonoChain(chains[(size_t)i], settings[(size_t)i], sampleRate);
+    }
+
+    auto processChains = [&]
+    {
+        buffer.makeCopyOf(source, true);
+        juce::dsp::AudioBlock<float> block(buffer);
+        for (int i = 0; i < numStreams; ++i)
+        {
+            auto channelBlock = block.getSingleChannelBlock((size_t)i);
+            chains[(size_t)i].process(juce::dsp::ProcessContextReplacing<float>(channelBlock));
+        }
+    };
+
+    //==============================================================================
+    BatchEQ singleThreaded, multiThreaded;
+    singleThreaded.prepare(numStreams, sampleRate, blockSize, 1);
+    multiThreaded.prepare(numStreams, sampleRate, blockSize, numThreads);
+    for (int i = 0; i < numStreams; ++i)
+    {
+        singleThreaded.setSettings(i, settings[(size_t)i]);
+        multiThreaded.setSettings(i, settings[(size_t)i]);
+    }
+
+    auto processBatch = [&](BatchEQ& batch)
+    {
+        buffer.makeCopyOf(source, true);
+        batch.process(buffer.getArrayOfWritePointers(), blockSize);
+    };
+
+    //==============================================================================
+    //every path must agree before their timings mean anything
+    juce::AudioBuffer<float> reference;
+    processProcessors();
+    reference.makeCopyOf(buffer);
+
+    processChains();
+    const auto chainError = getMaxDifference(buffer, reference);
+    processBatch(singleThreaded);
+    const auto batchError = getMaxDifference(buffer, reference);
+
+    const auto processorSeconds = timeBlocks(numBlocks, processProcessors);
+    const auto chainSeconds = timeBlocks(numBlocks, processChains);
+    const auto singleSeconds = timeBlocks(numBlocks, [&] { processBatch(singleThreaded); });
+    const auto multiSeconds = timeBlocks(numBlocks, [&] { processBatch(multiThreaded); });
+
+    for (auto& processor : processors)
+        processor->releaseResources();
+
+    auto report = [seconds, processorSeconds](const char* name, double elapsed)
+    {
+        std::cout << juce::String(name).paddedRight(' ', 28)
+                  << juce::String(elapsed * 1000.0, 1).paddedLeft(' ', 10) << " ms"
+                  << juce::String(seconds / elapsed, 1).paddedLeft(' ', 10) << "x realtime"
+                  << juce::String(processorSeconds / elapsed, 2).paddedLeft(' ', 8) << "x baseline"
+                  << std::endl;
+    };
+
+    std::cout << numStreams << " streams, " << seconds << " s at " << sampleRate << " Hz, block "
+              << blockSize << ", " << BatchEQ::getNumLanes() << " lanes, " << numThreads << " threads" << std::endl;
+    std::cout << "max |MonoChain - plugin| = " << chainError << std::endl
+              << "max |BatchEQ - plugin|   = " << batchError << " (tolerance " << tolerance << ")" << std::endl;
+
+    report("plugin instance per stream", processorSeconds);
+    report("MonoChain per stream", chainSeconds);
+    report("BatchEQ, 1 thread", singleSeconds);
+    report("BatchEQ, thread pool", multiSeconds);
+
+    if (chainError > tolerance || batchError > tolerance)
+    {
+        std::cout << "outputs differ beyond the tolerance" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*
+  ==============================================================================
+
+    DesignBenchmark.cpp
+
+    Compares the bilinear and matched designs with an oversampled bilinear
+    reference, in accuracy against the analog prototypes and in CPU, and
+    times the plugin's own Oversampling settings.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    struct TestCase
+    {
+        const char* name;
+        ChainSettings settings;
+        bool isPeak;   // otherwise the high cut is measured
+    };
+
+    ChainSettings makePeakSettings(float freq, float gainInDecibels, float quality)
+    {
+        ChainSettings settings;
+        settings.peakFreq = freq;
+        settings.peakGainInDecibels = gainInDecibels;
+        settings.peakQuality = quality;
+        return settings;
+    }
+
+    ChainSettings makeHighCutSettings(float freq, Slope slope)
+    {
+        ChainSettings settings;
+        settings.highCutFreq = freq;
+        settings.highCutSlope = slope;
+        return settings;
+    }
+
+    //magnitude of the analog prototype the designs approximate
+    double getAnalogMagnitude(const TestCase& test, double freq)
+    {
+        const auto& s = test.settings;
+        if (test.isPeak)
+        {
+            const auto A = std::sqrt(juce::Decibels::decibelsToGain((double)s.peakGainInDecibels));
+            const std::complex<double> jw(0.0, freq / s.peakFreq);
+            const auto numerator = jw * jw + jw * (A / s.peakQuality) + 1.0;
+            const auto denominator = jw * jw + jw / (A * s.peakQuality) + 1.0;
+            return std::abs(numerator / denominator);
+        }
+
+        const auto order = 2 * (s.highCutSlope + 1);
+        return 1.0 / std::sqrt(1.0 + std::pow(freq / s.highCutFreq, 2.0 * order));
+    }
+
+    double getDigitalMagnitude(const TestCase& test, double freq, double sampleRate)
+    {
+        if (test.isPeak)
+            return makePeakFilter(test.settings, sampleRate)->getMagnitudeForFrequency(freq, sampleRate);
+
+        double magnitude = 1.0;
+        for (auto* coefficients : makeHighCutFilter(test.settings, sampleRate))
+            magnitude *= coefficients->getMagnitudeForFrequency(freq, sampleRate);
+
+        return magnitude;
+    }
+
+    /**
+     largest dB difference from the analog response between 20 Hz and
+     min(20 kHz, 0.95 * Nyquist), ignoring frequencies where the analog
+     response is below -60 dB.
+     */
+    double getMaxErrorInDecibels(const TestCase& test, double baseSampleRate, int oversamplingFactor)
+    {
+        const auto topFreq = juce::jmin(20000.0, 0.475 * baseSampleRate);
+        const int numPoints = 512;
+
+        double maxError = 0.0;
+        for (int i = 0; i < numPoints; ++i)
+        {
+            const auto freq = juce::mapToLog10(double(i) / double(numPoints - 1), 20.0, topFreq);
+            const auto analog = juce::Decibels::gainToDecibels(getAnalogMagnitude(test, freq), -200.0);
+            if (analog < -60.0)
+                continue;
+
+            const auto digital = juce::Decibels::gainToDecibels(getDigitalMagnitude(test, freq, baseSampleRate * oversamplingFactor), -200.0);
+            maxError = juce::jmax(maxError, std::abs(digital - analog));
+        }
+
+        return maxError;
+    }
+
+    //==============================================================================
+    /** seconds of CPU per second of audio for one channel through a MonoChain. */
+    double measureCpu(const ChainSettings& settings, double sampleRate, int oversamplingFactorLog2, int blockSize, int seconds)
+    {
+        const auto factor = 1 << oversamplingFactorLog2;
+
+        juce::dsp::Oversampling<float> oversampling(1,
+            (size_t)oversamplingFactorLog2,
+            juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+        oversampling.initProcessing((size_t)blockSize);
+
+        juce::dsp::ProcessSpec spec;
+        spec.maximumBlockSize = (juce::uint32)(blockSize * factor);
+        spec.numChannels = 1;
+        spec.sampleRate = sampleRate * factor;
+
+        MonoChain chain;
+        chain.prepare(spec);
+        updateMonoChain(chain, settings, spec.sampleRate);
+
+        juce::AudioBuffer<float> buffer(1, blockSize);
+        juce::Random random(1);
+        for (int i = 0; i < blockSize; ++i)
+            buffer.setSample(0, i, random.nextFloat() * 2.f - 1.f);
+
+        const auto numBlocks = int(seconds * sampleRate) / blockSize;
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+
+            if (oversamplingFactorLog2 == 0)
+            {
+                chain.process(juce::dsp::ProcessContextReplacing<float>(block));
+            }
+            else
+            {
+                auto upsampled = oversampling.processSamplesUp(block);
+                chain.process(juce::dsp::ProcessContextReplacing<float>(upsampled));
+                oversampling.processSamplesDown(block);
+            }
+        }
+
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) / seconds;
+    }
+
+    /** seconds of CPU per second of stereo audio through the whole processBlock(), and the latency it reports. */
+    std::pair<double, int> measureProcessorCpu(int oversamplingOrder, int blockSize, int seconds)
+    {
+        const double sampleRate = 48000.0;
+
+        SimpleEQAudioProcessor processor;
+        auto set = [&processor](const char* parameterID, float value)
+        {
+            auto* parameter = processor.apvts.getParameter(parameterID);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+
+        set("Peak Freq", 12000.f);
+        set("Peak Gain", 12.f);
+        set("LowCut Freq", 40.f);
+        set("LowCut Slope", (float)Slope_24);
+        set("HighCut Freq", 16000.f);
+        set("HighCut Slope", (float)Slope_48);
+        set("Oversampling", (float)oversamplingOrder);
+
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        juce::Random random(1);
+
+        const auto numBlocks = int(seconds * sampleRate) / blockSize;
+        double elapsed = 0.0;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < blockSize; ++i)
+                    buffer.setSample(ch, i, random.nextFloat() * 2.f - 1.f);
+
+            auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            elapsed += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        }
+
+        return { elapsed / seconds, processor.getLatencySamples() };
+    }
+}
+
+int runDesignBenchmark(const juce::StringArray& args)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const auto blockSize = getIntOption(args, "block", 256);
+    const auto seconds = getIntOption(args, "seconds", 10);
+
+    const TestCase tests[] =
+    {
+        { "peak 12 kHz +12 dB Q1",  makePeakSettings(12000.f, 12.f, 1.f),  true },
+        { "peak 12 kHz -12 dB Q1",  makePeakSettings(12000.f, -12.f, 1.f), true },
+        { "peak 16 kHz +6 dB Q4",   makePeakSettings(16000.f, 6.f, 4.f),   true },
+        { "peak 2 kHz +12 dB Q1",   makePeakSettings(2000.f, 12.f, 1.f),   true },
+        { "high cut 16 kHz 12 dB",  makeHighCutSettings(16000.f, Slope_12), false },
+        { "high cut 16 kHz 48 dB",  makeHighCutSettings(16000.f, Slope_48), false },
+        { "high cut 8 kHz 24 dB",   makeHighCutSettings(8000.f, Slope_24),  false },
+    };
+
+    std::cout << "max |digital - analog| in dB, 20 Hz to 20 kHz" << std::endl;
+
+    for (auto sampleRate : { 44100.0, 48000.0 })
+    {
+        std::cout << std::endl << sampleRate << " Hz" << juce::String("bilinear").paddedLeft(' ', 20)
+                  << juce::String("matched").paddedLeft(' ', 10)
+                  << juce::String("bilin 2x").paddedLeft(' ', 10)
+                  << juce::String("bilin 4x").paddedLeft(' ', 10)
+                  << juce::String("bilin 8x").paddedLeft(' ', 10) << std::endl;
+
+        for (auto test : tests)
+        {
+            std::cout << juce::String(test.name).paddedRight(' ', 28);
+
+            test.settings.designMode = Design_Bilinear;
+            std::cout << juce::String(getMaxErrorInDecibels(test, sampleRate, 1), 3).paddedLeft(' ', 10);
+
+            test.settings.designMode = Design_Matched;
+            std::cout << juce::String(getMaxErrorInDecibels(test, sampleRate, 1), 3).paddedLeft(' ', 10);
+
+            test.settings.designMode = Design_Bilinear;
+            std::cout << juce::String(getMaxErrorInDecibels(test, sampleRate, 2), 3).paddedLeft(' ', 10);
+            std::cout << juce::String(getMaxErrorInDecibels(test, sampleRate, 4), 3).paddedLeft(' ', 10);
+            std::cout << juce::String(getMaxErrorInDecibels(test, sampleRate, 8), 3).paddedLeft(' ', 10) << std::endl;
+        }
+    }
+
+    //==============================================================================
+    ChainSettings settings = makePeakSettings(12000.f, 12.f, 1.f);
+    settings.lowCutFreq = 40.f;
+    settings.lowCutSlope = Slope_24;
+    settings.highCutFreq = 16000.f;
+    settings.highCutSlope = Slope_48;
+
+    std::cout << std::endl << "CPU per channel at 48 kHz, full chain (% of one core)" << std::endl;
+
+    settings.designMode = Design_Bilinear;
+    std::cout << "bilinear 1x" << juce::String(100.0 * measureCpu(settings, 48000.0, 0, blockSize, seconds), 4).paddedLeft(' ', 20) << std::endl;
+
+    settings.designMode = Design_Matched;
+    std::cout << "matched 1x " << juce::String(100.0 * measureCpu(settings, 48000.0, 0, blockSize, seconds), 4).paddedLeft(' ', 20) << std::endl;
+
+    settings.designMode = Design_Bilinear;
+    std::cout << "bilinear 2x" << juce::String(100.0 * measureCpu(settings, 48000.0, 1, blockSize, seconds), 4).paddedLeft(' ', 20) << std::endl;
+    std::cout << "bilinear 4x" << juce::String(100.0 * measureCpu(settings, 48000.0, 2, blockSize, seconds), 4).paddedLeft(' ', 20) << std::endl;
+    std::cout << "bilinear 8x" << juce::String(100.0 * measureCpu(settings, 48000.0, 3, blockSize, seconds), 4).paddedLeft(' ', 20) << std::endl;
+
+    //==============================================================================
+    std::cout << std::endl << "plugin processBlock at 48 kHz, stereo, per Oversampling setting (% of one core)" << std::endl;
+
+    for (int order = 0; order <= SimpleEQAudioProcessor::maxOversamplingOrder; ++order)
+    {
+        const auto [cpu, latency] = measureProcessorCpu(order, blockSize, seconds);
+        const auto name = order == 0 ? juce::String("off") : juce::String(1 << order) + "x";
+
+        std::cout << name.paddedRight(' ', 11)
+                  << juce::String(100.0 * cpu, 4).paddedLeft(' ', 20)
+                  << "   latency " << latency << " samples" << std::endl;
+    }
+
+    return 0;
+}
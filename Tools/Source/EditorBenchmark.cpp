@@ -0,0 +1,225 @@
+/*
+  ==============================================================================
+
+    EditorBenchmark.cpp
+
+    Builds the editor headlessly, feeds it synthetic audio and renders it into
+    offscreen images at several sizes, timing the analyzer, response curve and
+    stroking stages one by one.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/PluginEditor.h"
+
+namespace
+{
+    /** the durations of one stage over all frames. */
+    struct StageTimer
+    {
+        void add(double seconds)
+        {
+            total += seconds;
+            worst = juce::jmax(worst, seconds);
+            ++count;
+        }
+
+        double getMeanMicroseconds() const { return count > 0 ? 1.0e6 * total / count : 0.0; }
+
+        juce::String toString() const
+        {
+            return juce::String(getMeanMicroseconds(), 1).paddedLeft(' ', 10)
+                 + juce::String(1.0e6 * worst, 1).paddedLeft(' ', 10);
+        }
+
+        double total = 0.0, worst = 0.0;
+        int count = 0;
+    };
+
+    template<typename Function>
+    double timeSeconds(Function&& function)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        function();
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    }
+
+    /** an exponential sweep over a bed of noise, so the analyzer has something to draw across the band. */
+    struct SyntheticInput
+    {
+        explicit SyntheticInput(double sr) : sampleRate(sr) {}
+
+        void fill(juce::AudioBuffer<float>& buffer)
+        {
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                //20 Hz to 20 kHz every ten seconds
+                const auto position = std::fmod(time++ / (10.0 * sampleRate), 1.0);
+                const auto frequency = 20.0 * std::pow(1000.0, position);
+                phase = std::fmod(phase + juce::MathConstants<double>::twoPi * frequency / sampleRate, juce::MathConstants<double>::twoPi);
+
+                const auto sample = 0.3f * (float)std::sin(phase) + 0.05f * (random.nextFloat() * 2.f - 1.f);
+                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                    buffer.setSample(ch, i, sample);
+            }
+        }
+
+        const double sampleRate;
+        double time = 0.0, phase = 0.0;
+        juce::Random random{ 7 };
+    };
+
+    ResponseCurveComponent* findResponseCurve(juce::Component& parent)
+    {
+        for (auto* child : parent.getChildren())
+        {
+            if (auto* curve = dynamic_cast<ResponseCurveComponent*>(child))
+                return curve;
+
+            if (auto* curve = findResponseCurve(*child))
+                return curve;
+        }
+
+        return nullptr;
+    }
+}
+
+int runEditorBenchmark(const juce::StringArray& args)
+{
+    const auto numFrames = juce::jmax(1, getIntOption(args, "frames", 600));
+    const auto scale = (float)getStringOption(args, "scale", "1").getDoubleValue();
+    const auto budgetMicroseconds = getIntOption(args, "budget", 0);
+    const auto sizes = juce::StringArray::fromTokens(getStringOption(args, "sizes", "400x480,600x720,800x960,1200x1440"), ",", {});
+
+    //one 60 Hz editor tick's worth of audio per frame
+    const double sampleRate = 48000.0;
+    const auto samplesPerFrame = (int)sampleRate / 60;
+
+    SimpleEQAudioProcessor processor;
+    auto set = [&processor](const char* parameterID, float value)
+    {
+        auto* parameter = processor.apvts.getParameter(parameterID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    };
+
+    //a curve with some shape to it
+    set("LowCut Freq", 60.f);
+    set("LowCut Slope", (float)Slope_24);
+    set("Peak Freq", 1000.f);
+    set("Peak Gain", 6.f);
+    set("HighCut Freq", 12000.f);
+    set("HighCut Slope", (float)Slope_48);
+
+    processor.setRateAndBufferSizeDetails(sampleRate, samplesPerFrame);
+    processor.prepareToPlay(sampleRate, samplesPerFrame);
+
+    juce::AudioBuffer<float> buffer(2, samplesPerFrame);
+    juce::MidiBuffer midi;
+    SyntheticInput input(sampleRate);
+
+    std::cout << numFrames << " frames per size at " << scale << "x, microseconds per frame (mean, worst)" << std::endl;
+
+    bool overBudget = false;
+
+    for (auto& size : sizes)
+    {
+        const auto width = size.upToFirstOccurrenceOf("x", false, true).getIntValue();
+        const auto height = size.fromFirstOccurrenceOf("x", false, true).getIntValue();
+        if (width <= 0 || height <= 0)
+        {
+            std::cout << "bad size " << size << ", expected WIDTHxHEIGHT" << std::endl;
+            return 1;
+        }
+
+        //a new editor per size, as if it had been opened at that size
+        std::unique_ptr<juce::AudioProcessorEditor> editor(processor.createEditor());
+        editor->setSize(width, height);
+
+        auto* curve = findResponseCurve(*editor);
+        if (curve == nullptr)
+        {
+            std::cout << "the editor has no ResponseCurveComponent" << std::endl;
+            return 1;
+        }
+
+        StageTimer fft, analyzerPath, spectrogramColumn, curveEvaluation, stroking, editorPaint;
+
+        //the spectrogram column is pushed from inside generateAnalyzerPath(), so time it on its own
+        auto pushColumn = curve->onFFTFrame;
+        curve->onFFTFrame = [&](const std::vector<float>& fftData, const std::vector<float>& binFrequencies)
+        {
+            spectrogramColumn.add(timeSeconds([&] { if (pushColumn) pushColumn(fftData, binFrequencies); }));
+        };
+
+        juce::Image frame(juce::Image::ARGB, juce::roundToInt(width * scale), juce::roundToInt(height * scale), true);
+        juce::Image curveLayer(juce::Image::ARGB,
+            juce::jmax(1, juce::roundToInt(curve->getWidth() * scale)),
+            juce::jmax(1, juce::roundToInt(curve->getHeight() * scale)),
+            true);
+
+        for (int f = 0; f < numFrames; ++f)
+        {
+            //what the audio thread would have pushed between two ticks
+            input.fill(buffer);
+            processor.processBlock(buffer, midi);
+            processor.pullCoefficientSnapshot();
+
+            fft.add(timeSeconds([&] { curve->produceAnalyzerFrame(); }));
+
+            const auto columnBefore = spectrogramColumn.total;
+            const auto pathSeconds = timeSeconds([&] { curve->generateAnalyzerPath(); });
+            analyzerPath.add(pathSeconds - (spectrogramColumn.total - columnBefore));
+
+            juce::Path responseCurve;
+            curveEvaluation.add(timeSeconds([&] { responseCurve = curve->createResponseCurvePath(); }));
+
+            curveLayer.clear(curveLayer.getBounds());
+            stroking.add(timeSeconds([&]
+            {
+                juce::Graphics g(curveLayer);
+                g.addTransform(juce::AffineTransform::scale(scale));
+
+                g.setColour(juce::Colours::blue);
+                g.strokePath(curve->getAnalyzerPath(), juce::PathStrokeType(1.0f));
+
+                g.setColour(juce::Colours::white);
+                g.strokePath(responseCurve, juce::PathStrokeType(2.0f));
+            }));
+
+            //everything the editor draws, with its cached layers as they would be between parameter changes
+            editorPaint.add(timeSeconds([&]
+            {
+                juce::Graphics g(frame);
+                g.addTransform(juce::AffineTransform::scale(scale));
+                editor->paintEntireComponent(g, true);
+            }));
+        }
+
+        curve->onFFTFrame = pushColumn;
+
+        std::cout << std::endl << "editor " << width << "x" << height
+                  << " (response curve " << curve->getWidth() << "x" << curve->getHeight() << ")" << std::endl
+                  << "  analyzer FFT              " << fft.toString() << std::endl
+                  << "  analyzer path             " << analyzerPath.toString() << std::endl
+                  << "  spectrogram column        " << spectrogramColumn.toString() << std::endl
+                  << "  response curve evaluation " << curveEvaluation.toString() << std::endl
+                  << "  stroking                  " << stroking.toString() << std::endl
+                  << "  full editor paint         " << editorPaint.toString() << std::endl;
+
+        //a tick is the timer's stages plus one paint
+        const auto tickMicroseconds = fft.getMeanMicroseconds() + analyzerPath.getMeanMicroseconds()
+            + spectrogramColumn.getMeanMicroseconds() + editorPaint.getMeanMicroseconds();
+
+        if (budgetMicroseconds > 0 && tickMicroseconds > budgetMicroseconds)
+        {
+            std::cout << "  over budget: " << juce::String(tickMicroseconds, 1) << " us per tick" << std::endl;
+            overBudget = true;
+        }
+    }
+
+    processor.releaseResources();
+
+    return overBudget ? 1 : 0;
+}
@@ -0,0 +1,461 @@
+/*
+  ==============================================================================
+
+    GoldenCommand.cpp
+
+    Records golden outputs, magnitude responses and per-stage timings of the
+    MonoChain for a fixed corpus, and checks the current build against them.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/BatchEQ.h"
+#include "../../Source/ParallelRender.h"
+
+namespace
+{
+    constexpr int signalLength = 16384;
+    constexpr int numMagnitudePoints = 128;
+    constexpr int numTimingRuns = 5;
+    constexpr int numTimingRepeats = 20;
+
+    struct GoldenCase
+    {
+        juce::String name;
+        ChainSettings settings;
+        double sampleRate;
+    };
+
+    /**
+     every Slope of both cuts and a few peaks, for both designs and four sample
+     rates. The bands not under test keep the parameter defaults.
+     */
+    std::vector<GoldenCase> makeCorpus()
+    {
+        std::vector<GoldenCase> corpus;
+        const juce::StringArray slopeNames{ "12", "24", "36", "48" };
+
+        for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+        {
+            for (auto designMode : { Design_Bilinear, Design_Matched })
+            {
+                ChainSettings defaults;
+                defaults.lowCutFreq = 20.f;
+                defaults.highCutFreq = 20000.f;
+                defaults.peakFreq = 750.f;
+                defaults.designMode = designMode;
+
+                const auto suffix = juce::String(designMode == Design_Matched ? "-matched-" : "-bilinear-") + juce::String((int)sampleRate);
+
+                for (int slope = Slope_12; slope <= Slope_48; ++slope)
+                {
+                    auto settings = defaults;
+                    settings.lowCutFreq = 80.f;
+                    settings.lowCutSlope = static_cast<Slope>(slope);
+                    corpus.push_back({ "lowcut-" + slopeNames[slope] + suffix, settings, sampleRate });
+
+                    settings = defaults;
+                    settings.highCutFreq = 5000.f;
+                    settings.highCutSlope = static_cast<Slope>(slope);
+                    corpus.push_back({ "highcut-" + slopeNames[slope] + suffix, settings, sampleRate });
+                }
+
+                for (auto gain : { -12.f, 12.f })
+                {
+                    for (auto quality : { 0.7f, 4.f })
+                    {
+                        auto settings = defaults;
+                        settings.peakFreq = 1000.f;
+                        settings.peakGainInDecibels = gain;
+                        settings.peakQuality = quality;
+                        corpus.push_back({ "peak" + juce::String(gain > 0 ? "+" : "") + juce::String((int)gain) + "-q" + juce::String(quality, 1) + suffix, settings, sampleRate });
+                    }
+                }
+            }
+        }
+
+        return corpus;
+    }
+
+    /** an impulse followed by seeded white noise, the same for every case. */
+    juce::AudioBuffer<float> makeSignal()
+    {
+        juce::AudioBuffer<float> signal(1, signalLength);
+        juce::Random random(0x601d);
+
+        signal.setSample(0, 0, 1.f);
+        for (int i = 1; i < signalLength; ++i)
+            signal.setSample(0, i, random.nextFloat() * 2.f - 1.f);
+
+        return signal;
+    }
+
+    void prepareChain(MonoChain& chain, const GoldenCase& golden)
+    {
+        chain.prepare({ golden.sampleRate, (juce::uint32)signalLength, 1 });
+        updateMonoChain(chain, golden.settings, golden.sampleRate);
+    }
+
+    std::vector<float> getMagnitudes(const MonoChain& chain, double sampleRate)
+    {
+        auto& lowcut = chain.get<ChainPositions::LowCut>();
+        auto& highcut = chain.get<ChainPositions::HighCut>();
+
+        std::vector<float> magnitudes;
+        for (int i = 0; i < numMagnitudePoints; ++i)
+        {
+            const auto freq = juce::mapToLog10(double(i) / double(numMagnitudePoints - 1), 20.0, 0.45 * sampleRate);
+            double mag = 1.f;
+
+            if (!chain.isBypassed<ChainPositions::Peak>())
+                mag *= chain.get<ChainPositions::Peak>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+
+            if (!lowcut.isBypassed<0>()) mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!lowcut.isBypassed<1>()) mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!lowcut.isBypassed<2>()) mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!lowcut.isBypassed<3>()) mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+
+            if (!highcut.isBypassed<0>()) mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!highcut.isBypassed<1>()) mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!highcut.isBypassed<2>()) mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+            if (!highcut.isBypassed<3>()) mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
+
+            magnitudes.push_back((float)juce::Decibels::gainToDecibels(mag, -200.0));
+        }
+
+        return magnitudes;
+    }
+
+    //==============================================================================
+    /** nanoseconds per sample of one chain position, the best of a few runs. */
+    template<int Position>
+    double timeStage(MonoChain& chain, const juce::AudioBuffer<float>& signal)
+    {
+        juce::AudioBuffer<float> output(1, signalLength);
+        juce::dsp::AudioBlock<const float> inputBlock(signal);
+        juce::dsp::AudioBlock<float> outputBlock(output);
+
+        double best = std::numeric_limits<double>::max();
+        for (int run = 0; run < numTimingRuns; ++run)
+        {
+            chain.reset();
+
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numTimingRepeats; ++i)
+                chain.get<Position>().process(juce::dsp::ProcessContextNonReplacing<float>(inputBlock, outputBlock));
+
+            best = juce::jmin(best, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+        }
+
+        return 1.0e9 * best / (numTimingRepeats * signalLength);
+    }
+
+    struct Timings
+    {
+        double lowCut = 0, peak = 0, highCut = 0;
+    };
+
+    Timings timeStages(MonoChain& chain, const juce::AudioBuffer<float>& signal)
+    {
+        return { timeStage<ChainPositions::LowCut>(chain, signal),
+                 timeStage<ChainPositions::Peak>(chain, signal),
+                 timeStage<ChainPositions::HighCut>(chain, signal) };
+    }
+
+    //==============================================================================
+    /** distance in representable floats; 0 for identical values, including +0 and -0. */
+    juce::int64 getUlpDistance(float a, float b)
+    {
+        auto toOrdered = [](float f)
+        {
+            juce::int32 i;
+            std::memcpy(&i, &f, sizeof(i));
+            return i < 0 ? (juce::int64)std::numeric_limits<juce::int32>::min() - i : (juce::int64)i;
+        };
+
+        return std::abs(toOrdered(a) - toOrdered(b));
+    }
+
+    /**
+     a sample passes if it is within maxUlps of the golden one, or within
+     absoluteTolerance of it (for samples near zero, where ulps mean nothing).
+     */
+    struct Comparison
+    {
+        juce::int64 worstUlps = 0;
+        float worstDifference = 0;
+        int numFailures = 0;
+
+        void add(float golden, float actual, juce::int64 maxUlps, float absoluteTolerance)
+        {
+            const auto ulps = getUlpDistance(golden, actual);
+            const auto difference = std::abs(golden - actual);
+
+            worstUlps = juce::jmax(worstUlps, ulps);
+            worstDifference = juce::jmax(worstDifference, difference);
+
+            if (ulps > maxUlps && difference > absoluteTolerance)
+                ++numFailures;
+        }
+    };
+
+    //==============================================================================
+    juce::File getOutputFile(const juce::File& directory, const GoldenCase& golden)
+    {
+        return directory.getChildFile(golden.name + ".f32");
+    }
+
+    bool writeSamples(const juce::File& file, const float* samples, int numSamples)
+    {
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        if (stream.failedToOpen())
+            return false;
+
+        for (int i = 0; i < numSamples; ++i)
+            stream.writeFloat(samples[i]);
+
+        return true;
+    }
+
+    std::vector<float> readSamples(const juce::File& file)
+    {
+        juce::FileInputStream stream(file);
+        if (stream.failedToOpen())
+            return {};
+
+        std::vector<float> samples((size_t)(stream.getTotalLength() / (juce::int64)sizeof(float)));
+        for (auto& sample : samples)
+            sample = stream.readFloat();
+
+        return samples;
+    }
+
+    juce::var toVar(const std::vector<float>& values)
+    {
+        juce::Array<juce::var> array;
+        for (auto v : values)
+            array.add(v);
+
+        return array;
+    }
+
+    //==============================================================================
+    int record(const juce::File& directory)
+    {
+        if (!directory.createDirectory())
+        {
+            std::cerr << "could not create " << directory.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        const auto signal = makeSignal();
+        juce::Array<juce::var> cases;
+
+        for (auto& golden : makeCorpus())
+        {
+            MonoChain chain;
+            prepareChain(chain, golden);
+
+            juce::AudioBuffer<float> output;
+            output.makeCopyOf(signal);
+            juce::dsp::AudioBlock<float> block(output);
+            chain.process(juce::dsp::ProcessContextReplacing<float>(block));
+
+            if (!writeSamples(getOutputFile(directory, golden), output.getReadPointer(0), signalLength))
+            {
+                std::cerr << "could not write " << getOutputFile(directory, golden).getFullPathName() << std::endl;
+                return 1;
+            }
+
+            const auto timings = timeStages(chain, signal);
+
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("name", golden.name);
+            entry->setProperty("magnitudes", toVar(getMagnitudes(chain, golden.sampleRate)));
+            entry->setProperty("lowCutNs", timings.lowCut);
+            entry->setProperty("peakNs", timings.peak);
+            entry->setProperty("highCutNs", timings.highCut);
+            cases.add(juce::var(entry));
+
+            std::cout << "recorded " << golden.name << std::endl;
+        }
+
+        auto* manifest = new juce::DynamicObject();
+        manifest->setProperty("signalLength", signalLength);
+        manifest->setProperty("cases", cases);
+
+        if (!directory.getChildFile("golden.json").replaceWithText(juce::JSON::toString(juce::var(manifest))))
+        {
+            std::cerr << "could not write golden.json" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    int check(const juce::File& directory, juce::int64 maxUlps, float maxDecibels, double maxSlowdown, bool checkTimings)
+    {
+        const auto manifest = juce::JSON::parse(directory.getChildFile("golden.json"));
+        if ((int)manifest["signalLength"] != signalLength)
+        {
+            std::cerr << "no golden data for this corpus in " << directory.getFullPathName() << ", run with --record first" << std::endl;
+            return 1;
+        }
+
+        std::map<juce::String, juce::var> entries;
+        if (auto* cases = manifest["cases"].getArray())
+            for (auto& entry : *cases)
+                entries[entry["name"].toString()] = entry;
+
+        const auto signal = makeSignal();
+        int numFailedCases = 0;
+        Timings goldenTotal, currentTotal;
+
+        std::cout << juce::String("case").paddedRight(' ', 32)
+                  << juce::String("chain ulps").paddedLeft(' ', 12)
+                  << juce::String("batch ulps").paddedLeft(' ', 12)
+                  << juce::String("parallel").paddedLeft(' ', 12)
+                  << juce::String("dB").paddedLeft(' ', 10) << std::endl;
+
+        for (auto& golden : makeCorpus())
+        {
+            const auto expected = readSamples(getOutputFile(directory, golden));
+            const auto found = entries.find(golden.name);
+            if (found == entries.end() || (int)expected.size() != signalLength)
+            {
+                std::cout << juce::String(golden.name).paddedRight(' ', 32) << "  missing golden data" << std::endl;
+                ++numFailedCases;
+                continue;
+            }
+
+            const auto& entry = found->second;
+
+            //the MonoChain itself: any change to the designs or the filter path shows up here
+            MonoChain chain;
+            prepareChain(chain, golden);
+
+            juce::AudioBuffer<float> chainOutput;
+            chainOutput.makeCopyOf(signal);
+            {
+                juce::dsp::AudioBlock<float> block(chainOutput);
+                chain.process(juce::dsp::ProcessContextReplacing<float>(block));
+            }
+
+            //the engines that must stay equivalent to it
+            juce::AudioBuffer<float> batchOutput;
+            batchOutput.makeCopyOf(signal);
+            {
+                BatchEQ batch;
+                batch.prepare(1, golden.sampleRate, signalLength, 1);
+                batch.setSettings(0, golden.settings);
+                batch.process(batchOutput.getArrayOfWritePointers(), signalLength);
+            }
+
+            juce::AudioBuffer<float> parallelOutput;
+            parallelOutput.makeCopyOf(signal);
+            {
+                ParallelIIRRenderer renderer(golden.settings, golden.sampleRate, 1, 4, signalLength / 4);
+                renderer.process(parallelOutput);
+            }
+
+            Comparison chainComparison, batchComparison, parallelComparison;
+            for (int i = 0; i < signalLength; ++i)
+            {
+                chainComparison.add(expected[(size_t)i], chainOutput.getSample(0, i), maxUlps, 1.0e-7f);
+                batchComparison.add(expected[(size_t)i], batchOutput.getSample(0, i), maxUlps, 1.0e-7f);
+                parallelComparison.add(expected[(size_t)i], parallelOutput.getSample(0, i), 0, 1.0e-4f);
+            }
+
+            float worstDecibels = 0;
+            const auto magnitudes = getMagnitudes(chain, golden.sampleRate);
+            if (auto* goldenMagnitudes = entry["magnitudes"].getArray())
+            {
+                for (int i = 0; i < juce::jmin(goldenMagnitudes->size(), (int)magnitudes.size()); ++i)
+                {
+                    //below -120 dB the curve is noise
+                    const auto goldenValue = (float)(*goldenMagnitudes)[i];
+                    if (goldenValue > -120.f)
+                        worstDecibels = juce::jmax(worstDecibels, std::abs(goldenValue - magnitudes[(size_t)i]));
+                }
+            }
+
+            const auto failed = chainComparison.numFailures > 0
+                || batchComparison.numFailures > 0
+                || parallelComparison.numFailures > 0
+                || worstDecibels > maxDecibels;
+
+            std::cout << juce::String(golden.name).paddedRight(' ', 32)
+                      << juce::String(chainComparison.worstUlps).paddedLeft(' ', 12)
+                      << juce::String(batchComparison.worstUlps).paddedLeft(' ', 12)
+                      << juce::String(parallelComparison.worstDifference, 7).paddedLeft(' ', 12)
+                      << juce::String(worstDecibels, 4).paddedLeft(' ', 10)
+                      << (failed ? "  FAILED" : "") << std::endl;
+
+            if (failed)
+                ++numFailedCases;
+
+            if (checkTimings)
+            {
+                const auto timings = timeStages(chain, signal);
+                currentTotal.lowCut += timings.lowCut;
+                currentTotal.peak += timings.peak;
+                currentTotal.highCut += timings.highCut;
+                goldenTotal.lowCut += (double)entry["lowCutNs"];
+                goldenTotal.peak += (double)entry["peakNs"];
+                goldenTotal.highCut += (double)entry["highCutNs"];
+            }
+        }
+
+        //timings are compared summed over the corpus, single cases are too noisy
+        if (checkTimings)
+        {
+            std::cout << std::endl << "ns per sample, corpus total    golden     current" << std::endl;
+
+            auto checkStage = [&](const char* name, double goldenNs, double currentNs)
+            {
+                const auto slow = currentNs > goldenNs * maxSlowdown;
+                std::cout << juce::String(name).paddedRight(' ', 30)
+                          << juce::String(goldenNs, 1).paddedLeft(' ', 8)
+                          << juce::String(currentNs, 1).paddedLeft(' ', 12)
+                          << (slow ? "  SLOWER" : "") << std::endl;
+                return slow;
+            };
+
+            auto slow = checkStage("LowCut", goldenTotal.lowCut, currentTotal.lowCut);
+            slow = checkStage("Peak", goldenTotal.peak, currentTotal.peak) || slow;
+            slow = checkStage("HighCut", goldenTotal.highCut, currentTotal.highCut) || slow;
+
+            if (slow)
+            {
+                std::cerr << "a stage is more than " << maxSlowdown << "x slower than the golden run" << std::endl;
+                return 1;
+            }
+        }
+
+        if (numFailedCases > 0)
+        {
+            std::cerr << numFailedCases << " case(s) differ from the golden data" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+int runGolden(const juce::StringArray& args)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const auto directory = juce::File::getCurrentWorkingDirectory().getChildFile(getStringOption(args, "dir", "golden"));
+
+    if (args.contains("--record"))
+        return record(directory);
+
+    const auto maxUlps = (juce::int64)getIntOption(args, "ulps", 4);
+    const auto maxDecibels = getStringOption(args, "db", "0.001").getFloatValue();
+    const auto maxSlowdown = getStringOption(args, "slowdown", "1.25").getDoubleValue();
+
+    return check(directory, maxUlps, maxDecibels, maxSlowdown, !args.contains("--no-timing"));
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless tools and benchmarks built from the SimpleEQ sources.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ToolCommands.h"
+
+namespace
+{
+    struct Command
+    {
+        const char* name;
+        const char* description;
+        int (*run)(const juce::StringArray&);
+    };
+
+    const Command commands[] =
+    {
+        { "batch-bench", "BatchEQ against one plugin instance and one MonoChain per stream [--streams N] [--block N] [--seconds N] [--threads N] [--tolerance X]", runBatchBenchmark },
+        { "design-bench", "bilinear vs matched vs oversampled designs, accuracy and CPU, and the Oversampling settings [--block N] [--seconds N]", runDesignBenchmark },
+        { "match-eq", "fit the EQ so --target matches --reference [--order 11|12|13] [--threads N] [--matched]", runMatchEQ },
+        { "render", "parallel-in-time render of --input (or --seconds of noise) [--output F] [--threads N] [--chunk N] [--verify]", runRender },
+        { "golden", "check against the golden corpus in --dir [--record] [--ulps N] [--db X] [--slowdown X] [--no-timing]", runGolden },
+        { "spectrum", "spectra of --input (file or folder) or --list [--mode average|peak|frames] [--format csv|binary|png] [--order N] [--hop N] [--output DIR]", runSpectrum },
+        { "stress", "processBlock timings under dense automation and state recalls [--block N] [--seconds N] [--automation-threads N] [--rate N] [--state-interval MS]", runStress },
+        { "editor-bench", "headless editor rendering, analyzer/curve/stroking/paint times per size [--sizes WxH,...] [--scale X] [--frames N] [--budget US]", runEditorBenchmark },
+    };
+
+    void printUsage()
+    {
+        std::cout << "usage: SimpleEQTools <command> [options]" << std::endl << std::endl;
+        for (auto& command : commands)
+            std::cout << "  " << command.name << "  " << command.description << std::endl;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+
+    if (args.isEmpty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto name = args[0];
+    args.remove(0);
+
+    for (auto& command : commands)
+        if (name == command.name)
+            return command.run(args);
+
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    MatchEQCommand.cpp
+
+    Fits the EQ so a target file matches a reference file's long-term spectrum.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/MatchEQ.h"
+
+int runMatchEQ(const juce::StringArray& args)
+{
+    const juce::File referenceFile = juce::File::getCurrentWorkingDirectory().getChildFile(getStringOption(args, "reference"));
+    const juce::File targetFile = juce::File::getCurrentWorkingDirectory().getChildFile(getStringOption(args, "target"));
+    const auto order = static_cast<FFTOrder>(juce::jlimit((int)order2048, (int)order8192, getIntOption(args, "order", order4096)));
+    const auto numThreads = getIntOption(args, "threads", juce::SystemStats::getNumCpus());
+    const auto designMode = args.contains("--matched") ? Design_Matched : Design_Bilinear;
+
+    if (!referenceFile.existsAsFile() || !targetFile.existsAsFile())
+    {
+        std::cerr << "match-eq needs --reference <file> and --target <file>" << std::endl;
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    auto start = juce::Time::getHighResolutionTicks();
+
+    const auto reference = MatchEQ::computeAverageSpectrum(referenceFile, formatManager, order, numThreads);
+    const auto target = MatchEQ::computeAverageSpectrum(targetFile, formatManager, order, numThreads);
+
+    if (!reference.isValid() || !target.isValid())
+    {
+        std::cerr << "could not analyse " << (reference.isValid() ? targetFile : referenceFile).getFullPathName() << std::endl;
+        return 1;
+    }
+
+    const auto analysisSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    const auto result = MatchEQ::fitChainSettings(reference, target, designMode);
+    const auto totalSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    const auto& s = result.settings;
+    const juce::StringArray slopeNames{ "12db/Oct", "24db/Oct", "36db/Oct", "48db/Oct" };
+
+    std::cout << "LowCut Freq     " << s.lowCutFreq << " Hz" << std::endl
+              << "LowCut Slope    " << slopeNames[s.lowCutSlope] << std::endl
+              << "Peak Freq       " << s.peakFreq << " Hz" << std::endl
+              << "Peak Gain       " << s.peakGainInDecibels << " dB" << std::endl
+              << "Peak Quality    " << s.peakQuality << std::endl
+              << "HighCut Freq    " << s.highCutFreq << " Hz" << std::endl
+              << "HighCut Slope   " << slopeNames[s.highCutSlope] << std::endl
+              << "Filter Design   " << (s.designMode == Design_Matched ? "Matched" : "Bilinear") << std::endl
+              << std::endl
+              << "level offset    " << result.levelOffsetInDecibels << " dB (apply as output gain)" << std::endl
+              << "residual error  " << result.rmsErrorInDecibels << " dB rms" << std::endl
+              << "frames          " << reference.numFrames << " + " << target.numFrames << std::endl
+              << "analysis        " << juce::String(analysisSeconds, 2) << " s, total " << juce::String(totalSeconds, 2) << " s" << std::endl;
+
+    return 0;
+}
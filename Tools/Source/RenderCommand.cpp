@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    RenderCommand.cpp
+
+    Renders a long file through the EQ with ParallelIIRRenderer and checks it
+    against sequential MonoChain processing.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/ParallelRender.h"
+
+namespace
+{
+    ChainSettings makeRenderSettings()
+    {
+        //steep cuts and a narrow peak, so the chunk corrections are not trivial
+        ChainSettings settings;
+        settings.lowCutFreq = 40.f;
+        settings.lowCutSlope = Slope_48;
+        settings.peakFreq = 1000.f;
+        settings.peakGainInDecibels = 9.f;
+        settings.peakQuality = 4.f;
+        settings.highCutFreq = 12000.f;
+        settings.highCutSlope = Slope_24;
+        return settings;
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formatManager, const juce::File& file)
+    {
+        return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+    }
+}
+
+int runRender(const juce::StringArray& args)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const auto inputName = getStringOption(args, "input");
+    const auto outputName = getStringOption(args, "output");
+    const auto numThreads = getIntOption(args, "threads", juce::SystemStats::getNumCpus());
+    const auto chunkSize = getIntOption(args, "chunk", 1 << 16);
+    const auto segmentSize = getIntOption(args, "segment", 1 << 22);
+    const auto verify = args.contains("--verify");
+    const auto settings = makeRenderSettings();
+
+    //without --input, render --seconds of stereo noise at 48kHz
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    if (inputName.isNotEmpty())
+    {
+        reader = createReader(formatManager, juce::File::getCurrentWorkingDirectory().getChildFile(inputName));
+        if (reader == nullptr)
+        {
+            std::cerr << "could not read " << inputName << std::endl;
+            return 1;
+        }
+    }
+
+    const auto numChannels = reader != nullptr ? (int)reader->numChannels : 2;
+    const auto sampleRate = reader != nullptr ? reader->sampleRate : 48000.0;
+    const auto totalSamples = reader != nullptr ? reader->lengthInSamples : (juce::int64)(getIntOption(args, "seconds", 600) * sampleRate);
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    if (outputName.isNotEmpty())
+    {
+        auto outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(outputName);
+        outputFile.deleteFile();
+
+        juce::WavAudioFormat wav;
+        if (auto stream = outputFile.createOutputStream())
+            writer.reset(wav.createWriterFor(stream.release(), sampleRate, (unsigned int)numChannels, 24, {}, 0));
+
+        if (writer == nullptr)
+        {
+            std::cerr << "could not write " << outputName << std::endl;
+            return 1;
+        }
+    }
+
+    ParallelIIRRenderer renderer(settings, sampleRate, numChannels, numThreads, chunkSize);
+
+    std::vector<MonoChain> chains((size_t)(verify ? numChannels : 0));
+    for (auto& chain : chains)
+    {
+        chain.prepare({ sampleRate, (juce::uint32)segmentSize, 1 });
+        updateMonoChain(chain, settings, sampleRate);
+    }
+
+    juce::AudioBuffer<float> segment(numChannels, segmentSize), reference;
+    juce::Random random(0x5eed);
+
+    double parallelSeconds = 0, sequentialSeconds = 0;
+    float maxError = 0.f;
+
+    for (juce::int64 position = 0; position < totalSamples; position += segmentSize)
+    {
+        const auto numSamples = (int)juce::jmin((juce::int64)segmentSize, totalSamples - position);
+        segment.setSize(numChannels, numSamples, false, false, true);
+
+        if (reader != nullptr)
+        {
+            reader->read(&segment, 0, numSamples, position, true, true);
+        }
+        else
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < numSamples; ++i)
+                    segment.setSample(ch, i, random.nextFloat() * 2.f - 1.f);
+        }
+
+        if (verify)
+        {
+            reference.makeCopyOf(segment);
+
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                juce::dsp::AudioBlock<float> block(reference);
+                auto channelBlock = block.getSingleChannelBlock((size_t)ch);
+                chains[(size_t)ch].process(juce::dsp::ProcessContextReplacing<float>(channelBlock));
+            }
+            sequentialSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        renderer.process(segment);
+        parallelSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        if (verify)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const auto* a = segment.getReadPointer(ch);
+                const auto* b = reference.getReadPointer(ch);
+                for (int i = 0; i < numSamples; ++i)
+                    maxError = juce::jmax(maxError, std::abs(a[i] - b[i]));
+            }
+        }
+
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer(segment, 0, numSamples);
+    }
+
+    const auto audioSeconds = (double)totalSamples / sampleRate;
+
+    std::cout << "channels    " << numChannels << ", " << juce::String(audioSeconds, 1) << " s at " << sampleRate << " Hz" << std::endl
+              << "threads     " << numThreads << ", chunks of " << renderer.getChunkSize() << std::endl
+              << "parallel    " << juce::String(parallelSeconds, 3) << " s (" << juce::String(audioSeconds / parallelSeconds, 0) << "x realtime)" << std::endl;
+
+    if (verify)
+    {
+        std::cout << "sequential  " << juce::String(sequentialSeconds, 3) << " s, speedup " << juce::String(sequentialSeconds / parallelSeconds, 2) << "x" << std::endl
+                  << "max error   " << maxError << std::endl;
+
+        if (maxError > 1.0e-4f)
+        {
+            std::cerr << "parallel render differs from MonoChain by more than 1e-4" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
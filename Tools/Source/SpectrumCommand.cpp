@@ -0,0 +1,516 @@
+/*
+  ==============================================================================
+
+    SpectrumCommand.cpp
+
+    Batch spectrum analysis of audio files with the editor's FFT and path
+    generators, reading WAV/AIFF files through memory maps.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/Analyzer.h"
+
+namespace
+{
+    enum class Mode
+    {
+        average,
+        peakHold,
+        frames
+    };
+
+    enum class Format
+    {
+        csv,
+        binary,
+        png
+    };
+
+    struct Options
+    {
+        FFTOrder order = order4096;
+        int hop = 2048;
+        Mode mode = Mode::average;
+        Format format = Format::csv;
+        float negativeInfinity = -120.f;
+        juce::File outputDirectory;
+    };
+
+    constexpr int framesPerChunk = 64;
+    constexpr int minFramesPerJob = 4096;
+    constexpr int spectrogramHeight = 512, maxSpectrogramWidth = 4096;
+    constexpr int plotWidth = 1024, plotHeight = 400;
+
+    juce::String getExtension(Format format)
+    {
+        return format == Format::csv ? ".csv" : format == Format::binary ? ".spec" : ".png";
+    }
+
+    //==============================================================================
+    /** one input file; its jobs merge into it and the last one writes the result. */
+    struct FileAnalysis
+    {
+        juce::File file, outputFile;
+        double sampleRate = 0;
+        juce::int64 numFrames = 0;
+
+        //the outputs below are only allocated once a job of this file runs, and freed by its last one
+        juce::CriticalSection lock;
+        int remainingJobs = 0;
+        bool failed = false, written = false;
+        std::vector<double> accumulated;             // power sums or peak magnitudes, per bin
+        std::vector<float> spectrogram;              // frames mode as png: maxSpectrogramWidth columns of spectrogramHeight
+        std::unique_ptr<juce::FileOutputStream> frameStream;
+    };
+
+    std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formatManager, const juce::File& file, juce::Range<juce::int64> section)
+    {
+        //memory-mapped where the format allows it, so only the pages we touch are read
+        if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+            if (mapped != nullptr && mapped->mapSectionOfFile(section))
+                return mapped;
+        }
+
+        return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+    }
+
+    //==============================================================================
+    void writeHeader(juce::OutputStream& stream, const FileAnalysis& analysis, const Options& options, juce::int64 numRows)
+    {
+        const auto fftSize = 1 << options.order;
+
+        if (options.format == Format::csv)
+        {
+            stream << (options.mode == Mode::frames ? "time" : "frequency,db");
+            if (options.mode == Mode::frames)
+                for (int bin = 0; bin < fftSize / 2; ++bin)
+                    stream << "," << juce::String(bin * analysis.sampleRate / fftSize, 1);
+            stream << "\n";
+        }
+        else if (options.format == Format::binary)
+        {
+            //"SQSP", version, sample rate, FFT size, hop, rows; then rows of FFT size / 2 float32 dB values
+            stream.write("SQSP", 4);
+            stream.writeInt(1);
+            stream.writeDouble(analysis.sampleRate);
+            stream.writeInt(fftSize);
+            stream.writeInt(options.hop);
+            stream.writeInt64(numRows);
+        }
+    }
+
+    void writeRow(juce::OutputStream& stream, const Options& options, const float* decibels, int numBins, double time)
+    {
+        if (options.format == Format::binary)
+        {
+            for (int bin = 0; bin < numBins; ++bin)
+                stream.writeFloat(decibels[bin]);
+
+            return;
+        }
+
+        juce::String row(time, 4);
+        for (int bin = 0; bin < numBins; ++bin)
+            row << "," << juce::String(decibels[bin], 2);
+
+        stream << row << "\n";
+    }
+
+    bool writePlot(const juce::File& file, const std::vector<float>& decibels, const FileAnalysis& analysis, const Options& options)
+    {
+        const auto fftSize = 1 << options.order;
+
+        AnalyzerPathGenerator<juce::Path> pathProducer;
+        pathProducer.generatePath(decibels,
+            juce::Rectangle<float>(0, 0, (float)plotWidth, (float)plotHeight),
+            fftSize,
+            (float)(analysis.sampleRate / fftSize),
+            options.negativeInfinity);
+        pathProducer.pullLatestPath();
+
+        juce::Image image(juce::Image::RGB, plotWidth, plotHeight, true);
+        {
+            juce::Graphics g(image);
+            g.fillAll(juce::Colours::black);
+            g.setColour(juce::Colours::skyblue);
+            g.strokePath(pathProducer.getPath(), juce::PathStrokeType(1.f));
+        }
+
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        return stream.openedOk() && juce::PNGImageFormat().writeImageToStream(image, stream);
+    }
+
+    bool writeSpectrogram(const juce::File& file, const FileAnalysis& analysis, const Options& options)
+    {
+        const auto width = (int)juce::jmin((juce::int64)maxSpectrogramWidth, analysis.numFrames);
+        juce::Image image(juce::Image::RGB, juce::jmax(1, width), spectrogramHeight, true);
+
+        for (int x = 0; x < width; ++x)
+            for (int y = 0; y < spectrogramHeight; ++y)
+            {
+                const auto db = analysis.spectrogram[(size_t)(x * spectrogramHeight + y)];
+                const auto level = juce::jmap(juce::jlimit(options.negativeInfinity, 0.f, db), options.negativeInfinity, 0.f, 0.f, 1.f);
+                image.setPixelAt(x, spectrogramHeight - 1 - y, juce::Colour::greyLevel(level));
+            }
+
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        return stream.openedOk() && juce::PNGImageFormat().writeImageToStream(image, stream);
+    }
+
+    /** average and peak hold: the last job of a file writes its one spectrum. */
+    bool writeSpectrum(FileAnalysis& analysis, const Options& options)
+    {
+        const auto fftSize = 1 << options.order;
+        const auto numBins = fftSize / 2;
+
+        //same normalisation as FFTDataGenerator::produceFFTDataForRendering()
+        std::vector<float> decibels((size_t)numBins);
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            auto magnitude = analysis.accumulated[(size_t)bin];
+            if (options.mode == Mode::average)
+                magnitude = std::sqrt(magnitude / (double)juce::jmax((juce::int64)1, analysis.numFrames));
+
+            decibels[(size_t)bin] = juce::Decibels::gainToDecibels((float)(magnitude / numBins), options.negativeInfinity);
+        }
+
+        if (options.format == Format::png)
+            return writePlot(analysis.outputFile, decibels, analysis, options);
+
+        analysis.outputFile.deleteFile();
+        juce::FileOutputStream stream(analysis.outputFile);
+        if (!stream.openedOk())
+            return false;
+
+        writeHeader(stream, analysis, options, 1);
+
+        if (options.format == Format::binary)
+        {
+            writeRow(stream, options, decibels.data(), numBins, 0.0);
+        }
+        else
+        {
+            for (int bin = 0; bin < numBins; ++bin)
+                stream << juce::String(bin * analysis.sampleRate / fftSize, 2) << "," << juce::String(decibels[(size_t)bin], 2) << "\n";
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    struct AnalysisJob : juce::ThreadPoolJob
+    {
+        AnalysisJob(FileAnalysis& a, const Options& o, juce::AudioFormatManager& f, juce::int64 first, juce::int64 end)
+            : juce::ThreadPoolJob("spectrum"),
+            analysis(a),
+            options(o),
+            formatManager(f),
+            firstFrame(first),
+            endFrame(end)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            juce::ScopedNoDenormals noDenormals;
+
+            //only frames mode goes through the generator's mailbox
+            if (options.mode == Mode::frames)
+                generator.changeOrder(options.order);
+            else
+                generator.setTransformOrder(options.order);
+
+            const auto fftSize = generator.getFFTSize();
+            const auto numBins = fftSize / 2;
+            const auto hop = options.hop;
+
+            if (options.mode == Mode::frames && !openFrameOutput())
+                return finish(false);
+
+            auto reader = createReader(formatManager, analysis.file, { firstFrame * hop, (endFrame - 1) * hop + fftSize });
+            if (reader == nullptr)
+                return finish(false);
+
+            const auto numChannels = (int)reader->numChannels;
+
+            //the FIFO-sized buffers are the only audio in RAM
+            juce::AudioBuffer<float> chunk(numChannels, (framesPerChunk - 1) * hop + fftSize);
+            std::vector<float> mono((size_t)chunk.getNumSamples());
+            std::vector<float> magnitudes((size_t)fftSize * 2);
+            local.assign((size_t)numBins, 0.0);
+
+            for (auto frame = firstFrame; frame < endFrame; frame += framesPerChunk)
+            {
+                if (shouldExit())
+                    return finish(false);
+
+                const auto numFrames = (int)juce::jmin((juce::int64)framesPerChunk, endFrame - frame);
+                const auto numSamples = (numFrames - 1) * hop + fftSize;
+
+                reader->read(&chunk, 0, numSamples, frame * hop, true, true);
+
+                juce::FloatVectorOperations::copy(mono.data(), chunk.getReadPointer(0), numSamples);
+                for (int ch = 1; ch < numChannels; ++ch)
+                    juce::FloatVectorOperations::add(mono.data(), chunk.getReadPointer(ch), numSamples);
+                juce::FloatVectorOperations::multiply(mono.data(), 1.f / (float)numChannels, numSamples);
+
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    auto* frameStart = mono.data() + i * hop;
+
+                    if (options.mode == Mode::frames)
+                    {
+                        //exactly what the editor draws, one frame at a time
+                        juce::AudioBuffer<float> frameBuffer(&frameStart, 1, fftSize);
+                        generator.produceFFTDataForRendering(frameBuffer, options.negativeInfinity);
+                        generator.pullLatestFFTData();
+                        addFrame(frame + i, generator.getFFTData().data(), numBins);
+                        continue;
+                    }
+
+                    generator.computeMagnitudes(frameStart, magnitudes.data());
+
+                    if (options.mode == Mode::average)
+                    {
+                        for (int bin = 0; bin < numBins; ++bin)
+                            local[(size_t)bin] += (double)magnitudes[(size_t)bin] * (double)magnitudes[(size_t)bin];
+                    }
+                    else
+                    {
+                        for (int bin = 0; bin < numBins; ++bin)
+                            local[(size_t)bin] = juce::jmax(local[(size_t)bin], (double)magnitudes[(size_t)bin]);
+                    }
+                }
+            }
+
+            return finish(true);
+        }
+
+        /** frames mode has one job per file, which opens its stream or spectrogram here rather than up front. */
+        bool openFrameOutput()
+        {
+            const juce::ScopedLock sl(analysis.lock);
+
+            if (options.format == Format::png)
+            {
+                const auto width = juce::jmin((juce::int64)maxSpectrogramWidth, analysis.numFrames);
+                analysis.spectrogram.assign((size_t)(width * spectrogramHeight), options.negativeInfinity);
+                return true;
+            }
+
+            analysis.outputFile.deleteFile();
+            analysis.frameStream = std::make_unique<juce::FileOutputStream>(analysis.outputFile);
+            if (!analysis.frameStream->openedOk())
+                return false;
+
+            writeHeader(*analysis.frameStream, analysis, options, analysis.numFrames);
+            return true;
+        }
+
+        void addFrame(juce::int64 frame, const float* decibels, int numBins)
+        {
+            if (options.format != Format::png)
+            {
+                //frames mode runs one job per file, so the rows arrive in order
+                writeRow(*analysis.frameStream, options, decibels, numBins, (double)(frame * options.hop) / analysis.sampleRate);
+                return;
+            }
+
+            //the loudest frame of each column, on a log frequency axis
+            const auto width = juce::jmin((juce::int64)maxSpectrogramWidth, analysis.numFrames);
+            const auto x = (int)(frame * width / analysis.numFrames);
+            const auto binWidth = analysis.sampleRate / (2.0 * numBins);
+            auto* column = analysis.spectrogram.data() + x * spectrogramHeight;
+
+            for (int y = 0; y < spectrogramHeight; ++y)
+            {
+                const auto freq = juce::mapToLog10((double)y / (spectrogramHeight - 1), 20.0, juce::jmin(20000.0, 0.5 * analysis.sampleRate));
+                const auto bin = juce::jlimit(0, numBins - 1, juce::roundToInt(freq / binWidth));
+                column[y] = juce::jmax(column[y], decibels[bin]);
+            }
+        }
+
+        JobStatus finish(bool succeeded)
+        {
+            const juce::ScopedLock sl(analysis.lock);
+
+            if (succeeded && options.mode != Mode::frames)
+            {
+                if (analysis.accumulated.empty())
+                    analysis.accumulated.assign(local.size(), 0.0);
+
+                for (size_t bin = 0; bin < local.size(); ++bin)
+                {
+                    auto& value = analysis.accumulated[bin];
+                    value = options.mode == Mode::average ? value + local[bin] : juce::jmax(value, local[bin]);
+                }
+            }
+
+            if (!succeeded)
+            {
+                analysis.failed = true;
+                std::cerr << "could not analyse " << analysis.file.getFullPathName() << std::endl;
+            }
+
+            if (--analysis.remainingJobs == 0)
+            {
+                //a result missing some of its frames would still be normalised as if it had them all
+                if (!analysis.failed)
+                {
+                    analysis.written = true;
+                    if (options.mode != Mode::frames)
+                        analysis.written = writeSpectrum(analysis, options);
+                    else if (options.format == Format::png)
+                        analysis.written = writeSpectrogram(analysis.outputFile, analysis, options);
+                    else
+                        analysis.written = analysis.frameStream->getStatus().wasOk();
+
+                    if (!analysis.written)
+                        std::cerr << "could not write " << analysis.outputFile.getFullPathName() << std::endl;
+                }
+
+                analysis.frameStream.reset();
+                analysis.spectrogram = {};
+                analysis.accumulated = {};
+
+                //never leave a partial or stale result behind for a QC run to pick up
+                if (!analysis.written)
+                    analysis.outputFile.deleteFile();
+            }
+
+            return jobHasFinished;
+        }
+
+        FileAnalysis& analysis;
+        const Options& options;
+        juce::AudioFormatManager& formatManager;
+        juce::int64 firstFrame, endFrame;
+
+        FFTDataGenerator<std::vector<float>> generator;
+        std::vector<double> local;
+    };
+
+    //==============================================================================
+    void addInputs(const juce::File& input, juce::Array<juce::File>& files, juce::StringArray& outputNames)
+    {
+        if (input.isDirectory())
+        {
+            for (const auto& entry : juce::RangedDirectoryIterator(input, true, "*.wav;*.wave;*.aif;*.aiff;*.flac", juce::File::findFiles))
+            {
+                files.add(entry.getFile());
+                outputNames.add(entry.getFile().getRelativePathFrom(input).replaceCharacters("/\\", "__"));
+            }
+        }
+        else if (input.existsAsFile())
+        {
+            files.add(input);
+            outputNames.add(input.getFileName());
+        }
+    }
+}
+
+int runSpectrum(const juce::StringArray& args)
+{
+    Options options;
+    options.order = static_cast<FFTOrder>(juce::jlimit((int)order2048, (int)order8192, getIntOption(args, "order", order4096)));
+    options.hop = juce::jlimit(1, 1 << options.order, getIntOption(args, "hop", (1 << options.order) / 2));
+    options.negativeInfinity = (float)getIntOption(args, "floor", -120);
+
+    const auto mode = getStringOption(args, "mode", "average");
+    options.mode = mode == "peak" ? Mode::peakHold : mode == "frames" ? Mode::frames : Mode::average;
+
+    const auto format = getStringOption(args, "format", "csv");
+    options.format = format == "binary" ? Format::binary : format == "png" ? Format::png : Format::csv;
+
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    options.outputDirectory = cwd.getChildFile(getStringOption(args, "output", "spectra"));
+    const auto numThreads = getIntOption(args, "threads", juce::SystemStats::getNumCpus());
+
+    //--input is a file or a directory searched recursively, --list a text file of paths
+    juce::Array<juce::File> files;
+    juce::StringArray outputNames;
+
+    if (args.contains("--input"))
+        addInputs(cwd.getChildFile(getStringOption(args, "input")), files, outputNames);
+
+    if (args.contains("--list"))
+    {
+        juce::StringArray lines;
+        lines.addLines(cwd.getChildFile(getStringOption(args, "list")).loadFileAsString());
+        for (auto& line : lines)
+            if (line.trim().isNotEmpty())
+                addInputs(cwd.getChildFile(line.trim()), files, outputNames);
+    }
+
+    if (files.isEmpty() || !options.outputDirectory.createDirectory())
+    {
+        std::cerr << "spectrum needs --input <file or directory> or --list <file>, and a writable --output directory" << std::endl;
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    const auto fftSize = 1 << options.order;
+    auto start = juce::Time::getHighResolutionTicks();
+
+    juce::OwnedArray<FileAnalysis> analyses;
+    juce::OwnedArray<AnalysisJob> jobs;
+    double audioSeconds = 0;
+
+    for (int i = 0; i < files.size(); ++i)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(files[i]));
+        if (reader == nullptr || reader->numChannels == 0 || reader->lengthInSamples < fftSize)
+        {
+            std::cerr << "skipping " << files[i].getFullPathName() << std::endl;
+            continue;
+        }
+
+        auto* analysis = analyses.add(new FileAnalysis());
+        analysis->file = files[i];
+        analysis->outputFile = options.outputDirectory.getChildFile(outputNames[i] + getExtension(options.format));
+        analysis->sampleRate = reader->sampleRate;
+        analysis->numFrames = (reader->lengthInSamples - fftSize) / options.hop + 1;
+        audioSeconds += (double)reader->lengthInSamples / reader->sampleRate;
+
+        //long files are split so they use every core too; per-frame output stays in one job to keep the rows in order
+        const auto framesPerJob = options.mode == Mode::frames
+            ? analysis->numFrames
+            : juce::jmax((juce::int64)minFramesPerJob, (analysis->numFrames + numThreads - 1) / numThreads);
+
+        for (juce::int64 first = 0; first < analysis->numFrames; first += framesPerJob)
+        {
+            jobs.add(new AnalysisJob(*analysis, options, formatManager, first, juce::jmin(analysis->numFrames, first + framesPerJob)));
+            ++analysis->remainingJobs;
+        }
+    }
+
+    {
+        juce::ThreadPool pool(juce::jmax(1, numThreads));
+        for (auto* job : jobs)
+            pool.addJob(job, false);
+
+        for (auto* job : jobs)
+            pool.waitForJobToFinish(job, -1);
+    }
+
+    const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    int numWritten = 0;
+    for (auto* analysis : analyses)
+        if (analysis->written)
+            ++numWritten;
+
+    std::cout << "files       " << numWritten << " of " << files.size() << " written" << std::endl
+              << "audio       " << juce::String(audioSeconds / 3600.0, 2) << " h" << std::endl
+              << "time        " << juce::String(seconds, 2) << " s (" << juce::String(audioSeconds / seconds, 0) << "x realtime)" << std::endl;
+
+    return numWritten == files.size() ? 0 : 1;
+}
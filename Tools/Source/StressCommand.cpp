@@ -0,0 +1,246 @@
+/*
+  ==============================================================================
+
+    StressCommand.cpp
+
+    Hammers the processor's parameters and state from several threads while a
+    simulated realtime thread runs processBlock() against a deadline.
+
+  ==============================================================================
+*/
+
+#include "ToolCommands.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    struct StressShared
+    {
+        SimpleEQAudioProcessor& processor;
+        std::atomic<bool> running{ true };
+
+        //set while the audio thread is inside processBlock() / a state thread inside setStateInformation()
+        std::atomic<bool> inProcessBlock{ false }, inSetState{ false };
+        std::atomic<int> overlaps{ 0 };
+        std::atomic<juce::int64> parameterChanges{ 0 }, stateChanges{ 0 };
+    };
+
+    //==============================================================================
+    /** plays the host: one block per period, processBlock() timed against the period. */
+    struct AudioThread : juce::Thread
+    {
+        AudioThread(StressShared& s, int b, double sr, juce::int64 n)
+            : juce::Thread("stress audio"),
+            shared(s),
+            blockSize(b),
+            sampleRate(sr),
+            numBlocks(n)
+        {
+            durations.reserve((size_t)numBlocks);
+        }
+
+        void run() override
+        {
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::MidiBuffer midi;
+            juce::Random random(1);
+
+            const auto period = blockSize / sampleRate;
+            auto nextStart = juce::Time::getMillisecondCounterHiRes();
+
+            for (juce::int64 block = 0; block < numBlocks && !threadShouldExit(); ++block)
+            {
+                //sleep through most of the period, spin the last millisecond
+                nextStart += 1000.0 * period;
+                while (juce::Time::getMillisecondCounterHiRes() < nextStart - 1.0)
+                    juce::Thread::sleep(1);
+                while (juce::Time::getMillisecondCounterHiRes() < nextStart)
+                {
+                }
+
+                for (int ch = 0; ch < 2; ++ch)
+                    for (int i = 0; i < blockSize; ++i)
+                        buffer.setSample(ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+                shared.inProcessBlock.store(true);
+                if (shared.inSetState.load())
+                    ++shared.overlaps;
+
+                auto start = juce::Time::getHighResolutionTicks();
+                shared.processor.processBlock(buffer, midi);
+                durations.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+
+                shared.inProcessBlock.store(false);
+            }
+
+            shared.running.store(false);
+        }
+
+        StressShared& shared;
+        const int blockSize;
+        const double sampleRate;
+        const juce::int64 numBlocks;
+        std::vector<double> durations;
+    };
+
+    /** moves random parameters as fast as --rate allows, the way dense automation does. */
+    struct AutomationThread : juce::Thread
+    {
+        AutomationThread(StressShared& s, int seed, int r)
+            : juce::Thread("stress automation"),
+            shared(s),
+            random(seed),
+            changesPerSecond(r)
+        {
+        }
+
+        void run() override
+        {
+            const auto& parameters = shared.processor.getParameters();
+            auto next = juce::Time::getMillisecondCounterHiRes();
+
+            while (shared.running.load() && !threadShouldExit())
+            {
+                auto* parameter = parameters[random.nextInt(parameters.size())];
+                parameter->setValueNotifyingHost(random.nextFloat());
+                ++shared.parameterChanges;
+
+                next += 1000.0 / changesPerSecond;
+                const auto wait = next - juce::Time::getMillisecondCounterHiRes();
+                if (wait >= 1.0)
+                    juce::Thread::sleep((int)wait);
+            }
+        }
+
+        StressShared& shared;
+        juce::Random random;
+        const int changesPerSecond;
+    };
+
+    /** recalls presets like a host restoring a session, while the audio runs. */
+    struct StateThread : juce::Thread
+    {
+        StateThread(StressShared& s, std::vector<juce::MemoryBlock> st, int i)
+            : juce::Thread("stress state"),
+            shared(s),
+            states(std::move(st)),
+            intervalMs(i)
+        {
+        }
+
+        void run() override
+        {
+            size_t next = 0;
+            while (shared.running.load() && !threadShouldExit())
+            {
+                const auto& state = states[next++ % states.size()];
+
+                shared.inSetState.store(true);
+                if (shared.inProcessBlock.load())
+                    ++shared.overlaps;
+
+                shared.processor.setStateInformation(state.getData(), (int)state.getSize());
+
+                shared.inSetState.store(false);
+                ++shared.stateChanges;
+
+                juce::Thread::sleep(intervalMs);
+            }
+        }
+
+        StressShared& shared;
+        std::vector<juce::MemoryBlock> states;
+        const int intervalMs;
+    };
+
+    std::vector<juce::MemoryBlock> makeRandomStates(SimpleEQAudioProcessor& processor, int numStates)
+    {
+        juce::Random random(0x57a7e);
+        std::vector<juce::MemoryBlock> states;
+
+        for (int i = 0; i < numStates; ++i)
+        {
+            for (auto* parameter : processor.getParameters())
+                parameter->setValueNotifyingHost(random.nextFloat());
+
+            states.emplace_back();
+            processor.getStateInformation(states.back());
+        }
+
+        return states;
+    }
+
+    double getPercentile(const std::vector<double>& sorted, double percentile)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        const auto index = (size_t)std::ceil(percentile / 100.0 * (double)sorted.size()) - 1;
+        return sorted[juce::jmin(index, sorted.size() - 1)];
+    }
+}
+
+int runStress(const juce::StringArray& args)
+{
+    const auto blockSize = getIntOption(args, "block", 64);
+    const auto seconds = getIntOption(args, "seconds", 30);
+    const auto numAutomationThreads = getIntOption(args, "automation-threads", 3);
+    const auto changesPerSecond = juce::jmax(1, getIntOption(args, "rate", 2000));
+    const auto stateIntervalMs = getIntOption(args, "state-interval", 5);
+    const double sampleRate = 48000.0;
+    const auto numBlocks = (juce::int64)(seconds * sampleRate) / blockSize;
+
+    SimpleEQAudioProcessor processor;
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    StressShared shared{ processor };
+    const auto states = makeRandomStates(processor, 16);
+
+    AudioThread audioThread(shared, blockSize, sampleRate, numBlocks);
+    juce::OwnedArray<juce::Thread> hammers;
+    for (int i = 0; i < numAutomationThreads; ++i)
+        hammers.add(new AutomationThread(shared, 100 + i, changesPerSecond));
+    if (stateIntervalMs >= 0)
+        hammers.add(new StateThread(shared, states, stateIntervalMs));
+
+    for (auto* thread : hammers)
+        thread->startThread();
+
+    audioThread.startThread(10);
+
+    while (audioThread.isThreadRunning())
+        juce::Thread::sleep(100);
+
+    for (auto* thread : hammers)
+        thread->stopThread(1000);
+
+    processor.releaseResources();
+
+    //==============================================================================
+    auto durations = audioThread.durations;
+    std::sort(durations.begin(), durations.end());
+
+    const auto deadline = blockSize / sampleRate;
+    const auto missed = durations.end() - std::upper_bound(durations.begin(), durations.end(), deadline);
+    const auto toMicroseconds = [](double s) { return juce::String(s * 1.0e6, 1) + " us"; };
+
+    std::cout << "blocks            " << durations.size() << " of " << blockSize << " samples, deadline " << toMicroseconds(deadline) << std::endl
+              << "parameter moves   " << shared.parameterChanges.load() << " from " << numAutomationThreads << " threads" << std::endl
+              << "state recalls     " << shared.stateChanges.load() << std::endl
+              << std::endl
+              << "median            " << toMicroseconds(getPercentile(durations, 50.0)) << std::endl
+              << "99th              " << toMicroseconds(getPercentile(durations, 99.0)) << std::endl
+              << "99.99th           " << toMicroseconds(getPercentile(durations, 99.99)) << std::endl
+              << "worst             " << toMicroseconds(durations.empty() ? 0.0 : durations.back()) << std::endl
+              << "missed deadlines  " << missed << std::endl
+              << std::endl
+              << "setStateInformation() overlapping processBlock(): " << shared.overlaps.load() << std::endl;
+
+    //a recall only publishes a design, which the audio thread installs itself, so overlaps are expected
+    if (shared.overlaps.load() > 0)
+        std::cout << "  overlaps are safe, the chains are only touched by the audio thread;" << std::endl
+                  << "  build with -fsanitize=thread to check that no access conflicts" << std::endl;
+
+    return missed > 0 ? 1 : 0;
+}
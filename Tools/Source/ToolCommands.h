@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    ToolCommands.h
+
+    Entry points of the SimpleEQTools sub-commands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <iostream>
+
+/**
+ every command receives the arguments that follow its name and
+ returns the process exit code.
+ */
+int runBatchBenchmark(const juce::StringArray& args);
+int runDesignBenchmark(const juce::StringArray& args);
+int runMatchEQ(const juce::StringArray& args);
+int runRender(const juce::StringArray& args);
+int runGolden(const juce::StringArray& args);
+int runSpectrum(const juce::StringArray& args);
+int runStress(const juce::StringArray& args);
+int runEditorBenchmark(const juce::StringArray& args);
+
+/**
+ returns the integer after "--name" in args, or defaultValue if it is missing.
+ */
+inline int getIntOption(const juce::StringArray& args, const juce::String& name, int defaultValue)
+{
+    auto index = args.indexOf("--" + name);
+    if (index >= 0 && index + 1 < args.size())
+        return args[index + 1].getIntValue();
+
+    return defaultValue;
+}
+
+/**
+ returns the string after "--name" in args, or defaultValue if it is missing.
+ */
+inline juce::String getStringOption(const juce::StringArray& args, const juce::String& name, const juce::String& defaultValue = {})
+{
+    auto index = args.indexOf("--" + name);
+    if (index >= 0 && index + 1 < args.size())
+        return args[index + 1];
+
+    return defaultValue;
+}